@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// settings entered in the WiFi manager portal, sizes are part of the stored layout
+typedef struct {
+    char mqttServer[40];
+    char mqttPort[6];
+    char mqttUser[40];
+    char mqttPassword[40];
+    char discoveryPrefix[20];
+    char shutterDelay[5];
+} DeviceSettings;
+
+// pins and timing of a remote, initialized from SHUTTER_CONFIG and adjustable without reflashing
+typedef struct {
+    uint8_t pinUp;
+    uint8_t pinDown;
+    uint8_t pinStop;
+    uint8_t reserved;
+    uint32_t durationUpMs;
+    uint32_t durationDownMs;
+    uint16_t pressTimeMs;
+    uint16_t startLatencyMs;
+    uint16_t stopLatencyMs;
+    uint16_t reserved2;
+} ShutterCalibration;
+
+
+class ConfigStore {
+
+public:
+    void setDefaults(DeviceSettings &settings, ShutterCalibration *calibration);
+
+    bool load(DeviceSettings &settings, ShutterCalibration *calibration);
+    bool save(const DeviceSettings &settings, const ShutterCalibration *calibration);
+
+private:
+    typedef struct {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t shutterCount;
+        uint16_t reserved;
+    } ConfigHeader;
+
+    bool loadBinary(DeviceSettings &settings, ShutterCalibration *calibration);
+    bool migrateJson(DeviceSettings &settings);
+    void copyString(char *destination, size_t size, const char *source);
+    uint32_t updateCrc(uint32_t crc, const void *data, size_t length);
+
+};
+
+extern ConfigStore configStore;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+
+class DeadlineScheduler {
+
+public:
+    DeadlineScheduler();
+
+    void schedule(uint id, ulong dueMillis);
+    void cancel(uint id);
+
+    bool popDue(ulong nowMillis, uint &id);
+    ulong getNextDueInMs(ulong nowMillis);
+
+private:
+    typedef struct {
+        ulong dueMillis;
+        uint8_t id;
+    } Deadline;
+
+    // binary min heap of the deadlines and the position of every id within it, -1 if it is not scheduled
+    Deadline m_heap[SHUTTER_COUNT];
+    int8_t m_heapIndex[SHUTTER_COUNT];
+    uint m_size;
+
+    bool isBefore(const Deadline &a, const Deadline &b);
+    void swap(uint a, uint b);
+    void siftUp(uint index);
+    void siftDown(uint index);
+    void remove(uint index);
+
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* number of buckets, the upper limits are 100us, 250us, 500us, 1ms, 2.5ms, 5ms, 10ms, 25ms, 50ms and above */
+#define LATENCY_HISTOGRAM_BUCKETS 10
+
+
+class LatencyHistogram {
+
+public:
+    LatencyHistogram();
+
+    void add(ulong durationUs);
+    void reset();
+
+    ulong getCount(uint bucket);
+    ulong getMaxUs();
+
+private:
+    ulong m_counts[LATENCY_HISTOGRAM_BUCKETS];
+    ulong m_maxUs;
+
+};
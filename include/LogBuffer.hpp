@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoLog.h>
+
+/* highest log level compiled into the firmware, calls above it compile to nothing */
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX LOG_LEVEL_VERBOSE
+#endif
+
+/* size in bytes of the RAM ring buffer holding the log records until they are printed */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 2048
+#endif
+
+/* string arguments are copied into the record, longer strings are truncated */
+#ifndef LOG_STRING_MAX_LENGTH
+#define LOG_STRING_MAX_LENGTH 64
+#endif
+
+/* maximum size in bytes of the packed arguments of a single record */
+#ifndef LOG_ARGS_MAX_LENGTH
+#define LOG_ARGS_MAX_LENGTH 160
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_FATAL
+#define LOG_FATAL(format, ...) logBuffer.log(LOG_LEVEL_FATAL, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_FATAL(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) logBuffer.log(LOG_LEVEL_ERROR, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_WARNING
+#define LOG_WARNING(format, ...) logBuffer.log(LOG_LEVEL_WARNING, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_NOTICE
+#define LOG_NOTICE(format, ...) logBuffer.log(LOG_LEVEL_NOTICE, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_NOTICE(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_TRACE
+#define LOG_TRACE(format, ...) logBuffer.log(LOG_LEVEL_TRACE, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE(format, ...) logBuffer.log(LOG_LEVEL_VERBOSE, __FILE__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_VERBOSE(format, ...) do {} while (0)
+#endif
+
+
+class LogBuffer {
+
+public:
+    LogBuffer();
+
+    void begin(Print *output);
+    void setDeferred(bool deferred);
+
+    void log(uint8_t level, const char *file, uint16_t line, const char *format, ...);
+
+    bool isEmpty();
+    uint drain(uint maxRecords);
+
+    ulong getDroppedCount();
+
+private:
+    typedef struct {
+        ulong timestamp;
+        const char *file;
+        const char *format;
+        uint16_t line;
+        uint8_t level;
+        uint8_t argsLength;
+    } LogRecordHeader;
+
+    Print *m_output;
+    bool m_deferred;
+
+    uint8_t m_buffer[LOG_BUFFER_SIZE];
+    uint m_head;
+    uint m_used;
+
+    ulong m_droppedCount;
+    ulong m_reportedDroppedCount;
+
+    void write(const void *data, uint length);
+    void read(void *data, uint length);
+    uint packArgs(uint8_t *args, const char *format, va_list argList);
+    void printRecord(const LogRecordHeader &header, const uint8_t *args);
+    char getLevelChar(uint8_t level);
+
+};
+
+extern LogBuffer logBuffer;
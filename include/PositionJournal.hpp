@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "Shutter/ShutterAction.hpp"
+
+
+class PositionJournal {
+
+public:
+    PositionJournal();
+
+    void begin();
+
+    bool getPosition(uint shutterIndex, uint &position);
+
+    void recordMove(uint shutterIndex, uint position, ShutterAction moveAction);
+    void recordPosition(uint shutterIndex, uint position);
+
+    bool isFlushPending();
+    void flush();
+
+private:
+    typedef struct {
+        uint8_t marker;
+        uint8_t shutterIndex;
+        uint8_t position;
+        int8_t moveAction;
+        uint8_t checksum;
+    } JournalRecord;
+
+    typedef struct {
+        bool valid;
+        bool pending;
+        uint8_t position;
+        ShutterAction moveAction;
+    } JournalEntry;
+
+    JournalEntry m_entries[SHUTTER_COUNT];
+    uint m_recordCount;
+
+    void record(uint shutterIndex, uint position, ShutterAction moveAction);
+    bool append(const JournalRecord &record);
+    void compact();
+    JournalRecord createRecord(uint shutterIndex);
+    uint8_t getChecksum(const JournalRecord &record);
+    bool isValid(const JournalRecord &record);
+
+};
+
+extern PositionJournal positionJournal;
@@ -10,7 +10,7 @@
 class Shutter {
 
 public:
-    Shutter(String id);
+    Shutter(String id = "");
     
     void onActionInProgress (ShutterInternals::OnActionInProgressUserCallback callback);
     void onActionComplete(ShutterInternals::OnActionCompleteUserCallback callback);
@@ -20,39 +20,62 @@ public:
 
     void setControlPins(uint pinUp, uint pinDown, uint pinStop);
     void setDurationFullMoveMs(uint ms);
+    void setDurationFullMoveMs(uint upMs, uint downMs);
+    void setMotorLatencyMs(uint startMs, uint stopMs);
     void setDelayTimeMs(uint ms);
+    void setPressTimeMs(uint ms);
+    void restorePosition(uint position);
 
     uint getPosition();
+    uint getEstimatedPosition();
 
-    String getStatus();
+    const char *getStatus();
+    bool getNextActionMillis(ulong &dueMillis);
+    ulong getNextActionInMs();
 
     bool executeAction(ShutterAction shutterAction, uint position = 100);
+    bool executeActionAt(ShutterAction shutterAction, uint position, ulong executionTimeMillis);
+    bool stop(ulong stopMillis);
+
+    ulong getIdleMillis();
 
     bool isActionInProgress();
+    bool isMoving();
+    bool isButtonPressed();
 
     void tick();
 
 private:
     String m_id;
     
-    uint m_pinUp;
-    uint m_pinDown;
-    uint m_pinStop;
+    // pins indexed by ShutterAction::UP, DOWN and STOP
+    uint m_pins[3];
 
     uint m_delayTimeMs;
-    uint m_durationFullMoveMs;
+    uint m_pressTimeMs;
+    uint m_durationUpMs;
+    uint m_durationDownMs;
+    uint m_startLatencyMs;
+    uint m_stopLatencyMs;
     uint m_lastButtonPressMs;
 
     uint m_position;
  
     ShutterInternals::ShutterTask m_task;
 
-    int roundUp(int numToRound, int multiple);
     void setupPin(uint pin);
     uint getPin(ShutterAction shutterAction);
-    bool setPosition(uint position);    
+    bool setPosition(uint position, ulong executionTimeMillis);
+    bool retarget(int position, ulong stopMillis);
+    uint getTravelMs(ShutterAction direction, uint percent);
+    ulong getStopPressMillis(uint position, bool stopPressRequired);
+    uint getPositionAt(ulong timeMillis);
+    void scheduleAction(ShutterAction shutterAction, ulong executionTimeMillis);
     uint getNewPosition(ShutterAction shutterAction);
     void resetTask();
+    void finishTask();
+    void pressButton();
+    void releaseButton();
     uint getDelayMs(bool fOtherShutterActionInProgress);
 
     std::vector<ShutterInternals::OnActionInProgressUserCallback> m_onActionInProgressUserCallbacks;
@@ -6,7 +6,7 @@
 
 namespace ShutterInternals {
 
-typedef std::function<void(String id, ShutterAction shutterAction)> OnActionInProgressUserCallback;
-typedef std::function<void(String id, ShutterAction shutterAction, ShutterReason reason)> OnActionCompleteUserCallback;
+typedef std::function<void(const String &id, ShutterAction shutterAction)> OnActionInProgressUserCallback;
+typedef std::function<void(const String &id, ShutterAction shutterAction, ShutterReason reason)> OnActionCompleteUserCallback;
 
 }
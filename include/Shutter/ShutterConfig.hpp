@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+
+typedef struct {
+    const char *id;
+    uint pinUp;
+    uint pinDown;
+    uint pinStop;
+    uint durationUpMs;
+    uint durationDownMs;
+    uint pressTimeMs;
+    uint startLatencyMs;
+    uint stopLatencyMs;
+} ShutterConfig;
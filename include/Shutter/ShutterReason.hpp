@@ -3,4 +3,6 @@
 enum class ShutterReason : int8_t {
     SUCCESS = 0,
     DEVICE_BUSY = 1,
+    // replaced by a newer command before it was completed
+    SUPERSEDED = 2,
 };
\ No newline at end of file
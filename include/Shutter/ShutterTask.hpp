@@ -10,6 +10,12 @@ typedef struct {
     ulong executionTimeMillis = 0;
     ShutterAction shutterAction = ShutterAction::UNDEFINED_ACTION;
     uint stopRequiredAfterMillis = 0;
+    ulong pressStartMillis = 0;
+    ulong pressReleaseMillis = 0;
+    ulong moveStartMillis = 0;
+    ShutterAction moveAction = ShutterAction::UNDEFINED_ACTION;
+    int followUpPosition = -1;
+    bool stopPressRequired = true;
     uint newPosition = 0;
     bool reportProgressBegin = true;
 } ShutterTask;
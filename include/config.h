@@ -1,9 +1,130 @@
 #ifndef config_h
 #define config_h
 
+#include "Shutter/ShutterConfig.hpp"
+
 #define CLIENT_ID_PREFIX "ESP"
 
 /* defines whether, after WiFi and MQTT is connected, the onboard LED stays active */
 #define LED_ONBOARD_ACTIVE false
 
+/* shutters connected to the device: ID, pins for the up, down and stop button, duration of a full move up and down in ms, press time of a button in ms and start and stop latency of the motor in ms */
+constexpr ShutterConfig SHUTTER_CONFIG[] = {
+    { "Left", D5, D6, D7, 15650, 15650, 100, 100, 0 },
+    { "Right", D1, D2, D3, 15000, 15000, 100, 100, 0 },
+};
+
+constexpr uint SHUTTER_COUNT = sizeof(SHUTTER_CONFIG) / sizeof(SHUTTER_CONFIG[0]);
+
+/* binary config record with the MQTT settings and the shutter calibration, protected by a CRC */
+#define CONFIG_FILE "/config.bin"
+
+/* temporary file the config record is written to before it replaces the config record */
+#define CONFIG_TEMP_FILE "/config.tmp"
+
+/* layout version of the config record, a record of another version is ignored */
+#define CONFIG_VERSION 1
+
+/* JSON config of former versions, migrated into the config record once */
+#define CONFIG_JSON_FILE "/config.json"
+
+/* a changed calibration is only saved if no button of any shutter has to be pressed or released within this time in ms */
+#define CONFIG_SAVE_GUARD_MS 100
+
+/* binary file caching BSSID, channel and lease of the last WiFi connection for the fast boot */
+#define WIFI_CACHE_FILE "/wifi.bin"
+
+/* time in ms the fast boot waits for the cached access point before falling back to the WiFi manager */
+#define FAST_BOOT_TIMEOUT_MS 5000
+
+/* defines whether the fast boot reuses the last lease as static IP instead of waiting for DHCP, only if the router reserves it */
+#define FAST_BOOT_STATIC_IP false
+
+/* interval in ms in which the estimated position of a moving shutter is published */
+#define PROGRESS_PUBLISH_INTERVAL_MS 1000
+
+/* minimum change in percent of the estimated position before it is published again */
+#define PROGRESS_PUBLISH_MIN_DELTA 5
+
+/* progress is not published if a button of any shutter has to be pressed or released within this time in ms */
+#define PROGRESS_PUBLISH_GUARD_MS 50
+
+/* defines whether state, position and direction of a shutter are also published together as JSON on its json topic */
+#ifndef MQTT_STATE_JSON
+#define MQTT_STATE_JSON false
+#endif
+
+/* size of the MQTT client buffer, it has to hold the largest received message and non JSON publish */
+#define MQTT_BUFFER_SIZE 256
+
+/* number of preallocated slots for received MQTT messages, shared by all queues */
+#define MQTT_POOL_SIZE 10
+
+/* timeout in ms for the DNS lookup, the TCP connection and the CONNACK of the MQTT broker, each of them blocks the loop */
+#define MQTT_CONNECT_TIMEOUT_MS 2000
+
+/* a connection step is only taken if no button has to be pressed or released within this time in ms */
+#define MQTT_CONNECT_GUARD_MS 4500
+
+/* delay in ms before the first reconnect attempt, it is doubled after every failed attempt up to the maximum */
+#define MQTT_RECONNECT_MIN_MS 1000
+#define MQTT_RECONNECT_MAX_MS 60000
+
+/* overflow policies if all slots of the MQTT message pool are in use, coalescing by shutter replaces the commands pending
+   for the shutter of the received one and drops the received command if there are none, it only makes a difference if
+   MQTT_COALESCE_SHUTTER is false */
+#define MQTT_OVERFLOW_DROP_NEWEST 0
+#define MQTT_OVERFLOW_DROP_OLDEST 1
+#define MQTT_OVERFLOW_COALESCE_SHUTTER 2
+
+/* announce requests are always evicted first, then the policy decides between the received command and the pending ones */
+#define MQTT_OVERFLOW_POLICY MQTT_OVERFLOW_DROP_NEWEST
+
+/* defines whether a pending command for a shutter is replaced by a newer one for the same shutter */
+#define MQTT_COALESCE_SHUTTER true
+
+/* defines whether the topic of a message dropped because of a full pool is published on the rejected topic */
+#define MQTT_REJECT_NOTIFY true
+
+/* maximum length of a received MQTT payload, longer payloads are discarded */
+#define MQTT_PAYLOAD_MAX_LENGTH 15
+
+/* maximum length of a MQTT topic including the discovery prefix */
+#define MQTT_TOPIC_MAX_LENGTH 64
+
+/* interval in ms in which the loop and queue statistics are published on the diagnostics topic */
+#define DIAGNOSTICS_PUBLISH_INTERVAL_MS 60000
+
+/* defines whether received messages and the queue wait, start and completion of every shutter command are logged in a fixed TRACE format */
+#ifndef MQTT_TRACE
+#define MQTT_TRACE false
+#endif
+
+/* log records are not printed if a button of any shutter has to be pressed or released within this time in ms */
+#define LOG_DRAIN_GUARD_MS 50
+
+/* maximum number of log records printed per loop iteration */
+#define LOG_DRAIN_MAX_RECORDS 2
+
+/* gap in ms between the release of a button and the press on the next remote of a group move, so only one remote transmits at a time */
+#define GROUP_PRESS_GAP_MS 20
+
+/* maximum time in ms the loop idles while no shutter deadline is due and no work is pending */
+#define LOOP_IDLE_MAX_MS 5
+
+/* append-only journal of the shutter positions, restored after a reboot or power loss */
+#define POSITION_JOURNAL_FILE "/positions.bin"
+
+/* temporary file the journal is compacted into before it replaces the journal */
+#define POSITION_JOURNAL_COMPACT_FILE "/positions.tmp"
+
+/* number of records after which the journal is compacted to one record per shutter */
+#define POSITION_JOURNAL_MAX_RECORDS 512
+
+/* number of records read from the journal at once during startup */
+#define POSITION_JOURNAL_READ_CHUNK 32
+
+/* changed positions are written to the journal by the loop if no button of any shutter has to be pressed or released within this time in ms */
+#define POSITION_JOURNAL_GUARD_MS 50
+
 #endif
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "Arduino.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+NativeHost nativeHost;
+
+unsigned long millis() {
+    return nativeHost.getMillis();
+}
+
+unsigned long micros() {
+    return nativeHost.getMicros();
+}
+
+void delay(unsigned long ms) {
+    nativeHost.advanceMillis(ms);
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    nativeHost.writePin(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+    return nativeHost.readPin(pin);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+size_t Print::write(const char *str) {
+    return write((const uint8_t *) str, strlen(str));
+}
+
+size_t Print::print(const char *str) {
+    return write(str);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t) c);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long) value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print((unsigned long) value, base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == DEC) {
+        char buffer[24];
+
+        snprintf(buffer, sizeof(buffer), "%ld", value);
+        return print(buffer);
+    }
+    return print((unsigned long) value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char buffer[8 * sizeof(value) + 1];
+    char *c = &buffer[sizeof(buffer) - 1];
+
+    *c = '\0';
+    do {
+        uint digit = value % base;
+        *--c = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value > 0);
+
+    return print(c);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[32];
+
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return print(buffer);
+}
+
+size_t Print::println(const char *str) {
+    return print(str) + print("\r\n");
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    int c;
+
+    while (count < length && (c = read()) >= 0) {
+        buffer[count++] = (char) c;
+    }
+    return count;
+}
+
+String::String(const char *str) : m_str(str == NULL ? "" : str) {
+}
+
+String::String(const std::string &str) : m_str(str) {
+}
+
+String::String(char c) : m_str(1, c) {
+}
+
+String::String(int value) : m_str(std::to_string(value)) {
+}
+
+String::String(unsigned int value) : m_str(std::to_string(value)) {
+}
+
+String::String(long value) : m_str(std::to_string(value)) {
+}
+
+String::String(unsigned long value) : m_str(std::to_string(value)) {
+}
+
+const char *String::c_str() const {
+    return m_str.c_str();
+}
+
+unsigned int String::length() const {
+    return m_str.length();
+}
+
+long String::toInt() const {
+    return atol(m_str.c_str());
+}
+
+bool String::equalsIgnoreCase(const String &other) const {
+    return strcasecmp(m_str.c_str(), other.m_str.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    return m_str.compare(0, prefix.m_str.length(), prefix.m_str) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    return m_str.length() >= suffix.m_str.length() &&
+        m_str.compare(m_str.length() - suffix.m_str.length(), suffix.m_str.length(), suffix.m_str) == 0;
+}
+
+String &String::operator+=(const String &other) {
+    m_str += other.m_str;
+    return *this;
+}
+
+bool String::operator==(const String &other) const {
+    return m_str == other.m_str;
+}
+
+bool String::operator==(const char *other) const {
+    return m_str == other;
+}
+
+bool String::operator!=(const String &other) const {
+    return m_str != other.m_str;
+}
+
+bool String::operator!=(const char *other) const {
+    return m_str != other;
+}
+
+String operator+(const String &left, const String &right) {
+    return String(left.m_str + right.m_str);
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    nativeHost.writeSerial(c);
+    return 1;
+}
+
+uint32_t EspClass::getChipId() {
+    return 1234567;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return 40000;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+    return 30000;
+}
+
+uint8_t EspClass::getHeapFragmentation() {
+    return 0;
+}
+
+void EspClass::reset() {
+}
+
+void EspClass::restart() {
+}
+
+NativeHost::NativeHost() {
+    reset();
+}
+
+void NativeHost::reset() {
+    // the firmware treats 0 as "not set" for most timestamps, so the clock starts a bit later like on the device
+    m_micros = 1000000;
+    memset(m_pins, LOW, sizeof(m_pins));
+    m_pinWrites.clear();
+    m_inbound.clear();
+    m_published.clear();
+    m_serial.clear();
+    files.clear();
+    fileBytesWritten = 0;
+    flashSectorErases = 0;
+}
+
+void NativeHost::setMillis(unsigned long ms) {
+    m_micros = ms * 1000;
+}
+
+void NativeHost::advanceMillis(unsigned long ms) {
+    m_micros += ms * 1000;
+}
+
+unsigned long NativeHost::getMillis() {
+    return m_micros / 1000;
+}
+
+unsigned long NativeHost::getMicros() {
+    return m_micros;
+}
+
+void NativeHost::writePin(uint8_t pin, uint8_t value) {
+    if (pin < sizeof(m_pins)) {
+        m_pins[pin] = value;
+    }
+    m_pinWrites.push_back({getMillis(), pin, value});
+}
+
+uint8_t NativeHost::readPin(uint8_t pin) {
+    return pin < sizeof(m_pins) ? m_pins[pin] : LOW;
+}
+
+const std::vector<NativePinWrite> &NativeHost::getPinWrites() {
+    return m_pinWrites;
+}
+
+void NativeHost::clearPinWrites() {
+    m_pinWrites.clear();
+}
+
+void NativeHost::receiveMqtt(unsigned long dueMillis, const std::string &topic, const std::string &payload) {
+    m_inbound.push_back({dueMillis, topic, payload, false});
+}
+
+bool NativeHost::popDueMqtt(NativeMqttMessage &message) {
+    for (auto it = m_inbound.begin(); it != m_inbound.end(); it++) {
+        if ((long) (getMillis() - it->millis) >= 0) {
+            message = *it;
+            m_inbound.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void NativeHost::publishMqtt(const std::string &topic, const std::string &payload, bool retain) {
+    m_published.push_back({getMillis(), topic, payload, retain});
+}
+
+const std::vector<NativeMqttMessage> &NativeHost::getPublished() {
+    return m_published;
+}
+
+void NativeHost::clearPublished() {
+    m_published.clear();
+}
+
+void NativeHost::writeSerial(uint8_t c) {
+    m_serial += (char) c;
+}
+
+std::string NativeHost::takeSerial() {
+    std::string serial;
+
+    serial.swap(m_serial);
+    return serial;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+// host stand-in for the parts of the ESP8266 Arduino core used by the firmware, time only moves via NativeHost
+
+#include <sys/types.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+static const uint8_t D0 = 16;
+static const uint8_t D1 = 5;
+static const uint8_t D2 = 4;
+static const uint8_t D3 = 0;
+static const uint8_t D4 = 2;
+static const uint8_t D5 = 14;
+static const uint8_t D6 = 12;
+static const uint8_t D7 = 13;
+static const uint8_t D8 = 15;
+static const uint8_t LED_BUILTIN = 2;
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+inline bool isDigit(int c) {
+    return isdigit(c) != 0;
+}
+
+inline bool isSpace(int c) {
+    return isspace(c) != 0;
+}
+
+// glibc only provides strlcpy since 2.38, the ESP8266 toolchain always has it
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *destination, const char *source, size_t size) {
+    size_t length = strlen(source);
+
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(destination, source, copied);
+        destination[copied] = '\0';
+    }
+    return length;
+}
+#endif
+
+
+class Print {
+
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println(const char *str = "");
+
+};
+
+
+class Stream : public Print {
+
+public:
+    virtual int available() {
+        return 0;
+    }
+
+    virtual int read() {
+        return -1;
+    }
+
+    size_t readBytes(char *buffer, size_t length);
+
+};
+
+
+class String {
+
+public:
+    String(const char *str = "");
+    String(const std::string &str);
+    explicit String(char c);
+    explicit String(int value);
+    explicit String(unsigned int value);
+    explicit String(long value);
+    explicit String(unsigned long value);
+
+    const char *c_str() const;
+    unsigned int length() const;
+    long toInt() const;
+    bool equalsIgnoreCase(const String &other) const;
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+
+    String &operator+=(const String &other);
+    bool operator==(const String &other) const;
+    bool operator==(const char *other) const;
+    bool operator!=(const String &other) const;
+    bool operator!=(const char *other) const;
+
+    friend String operator+(const String &left, const String &right);
+
+private:
+    std::string m_str;
+
+};
+
+
+class HardwareSerial : public Stream {
+
+public:
+    void begin(unsigned long baud);
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    operator bool() {
+        return true;
+    }
+
+};
+
+extern HardwareSerial Serial;
+
+
+class EspClass {
+
+public:
+    uint32_t getChipId();
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+    uint8_t getHeapFragmentation();
+    void reset();
+    void restart();
+
+};
+
+extern EspClass ESP;
+
+#include "NativeHost.h"
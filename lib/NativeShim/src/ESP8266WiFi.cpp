@@ -0,0 +1,134 @@
+#include "ESP8266WiFi.h"
+
+ESP8266WiFiClass WiFi;
+
+IPAddress::IPAddress(uint32_t address) :
+    m_address(address) {
+}
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) :
+    m_address(first | (second << 8) | (third << 16) | ((uint32_t) fourth << 24)) {
+}
+
+IPAddress::operator uint32_t() const {
+    return m_address;
+}
+
+bool IPAddress::fromString(const char *address) {
+    uint parts[4];
+    char end;
+
+    if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &end) != 4 ||
+        parts[0] > 255 || parts[1] > 255 || parts[2] > 255 || parts[3] > 255) {
+        return false;
+    }
+    *this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", m_address & 0xFF, (m_address >> 8) & 0xFF, (m_address >> 16) & 0xFF, m_address >> 24);
+    return String(buffer);
+}
+
+ESP8266WiFiClass::ESP8266WiFiClass() :
+    m_bssid{0x02, 0x00, 0x00, 0x00, 0x00, 0x01} {
+}
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode) {
+    return true;
+}
+
+bool ESP8266WiFiClass::persistent(bool persistent) {
+    return true;
+}
+
+bool ESP8266WiFiClass::hostname(const String &hostname) {
+    return true;
+}
+
+bool ESP8266WiFiClass::setAutoReconnect(bool autoReconnect) {
+    return true;
+}
+
+bool ESP8266WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns) {
+    return true;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect) {
+    return WL_CONNECTED;
+}
+
+wl_status_t ESP8266WiFiClass::status() {
+    return WL_CONNECTED;
+}
+
+bool ESP8266WiFiClass::isConnected() {
+    return true;
+}
+
+String ESP8266WiFiClass::SSID() {
+    return String("native");
+}
+
+String ESP8266WiFiClass::psk() {
+    return String("");
+}
+
+uint8_t *ESP8266WiFiClass::BSSID() {
+    return m_bssid;
+}
+
+String ESP8266WiFiClass::BSSIDstr() {
+    return String("02:00:00:00:00:01");
+}
+
+int32_t ESP8266WiFiClass::channel() {
+    return 1;
+}
+
+IPAddress ESP8266WiFiClass::localIP() {
+    return IPAddress(192, 168, 0, 10);
+}
+
+IPAddress ESP8266WiFiClass::gatewayIP() {
+    return IPAddress(192, 168, 0, 1);
+}
+
+IPAddress ESP8266WiFiClass::subnetMask() {
+    return IPAddress(255, 255, 255, 0);
+}
+
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t dnsNo) {
+    return IPAddress(192, 168, 0, 1);
+}
+
+IPAddress ESP8266WiFiClass::softAPIP() {
+    return IPAddress(192, 168, 4, 1);
+}
+
+int ESP8266WiFiClass::hostByName(const char *hostName, IPAddress &result, uint32_t timeoutMs) {
+    result = IPAddress(192, 168, 0, 2);
+    return 1;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler) {
+    return WiFiEventHandler();
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler) {
+    return WiFiEventHandler();
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler) {
+    return WiFiEventHandler();
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return 1;
+}
+
+void WiFiClient::setTimeout(unsigned long timeout) {
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+
+public:
+    IPAddress(uint32_t address = 0);
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+
+    operator uint32_t() const;
+    bool fromString(const char *address);
+    String toString() const;
+
+private:
+    uint32_t m_address;
+
+};
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+struct WiFiEventStationModeConnected {
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+struct WiFiEventStationModeDisconnected {
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t reason;
+};
+
+struct WiFiEventStationModeGotIP {
+    IPAddress ip;
+    IPAddress mask;
+    IPAddress gw;
+};
+
+typedef std::shared_ptr<void> WiFiEventHandler;
+
+// the station is always connected to the same access point, the events are never raised
+class ESP8266WiFiClass {
+
+public:
+    ESP8266WiFiClass();
+
+    bool mode(WiFiMode_t mode);
+    bool persistent(bool persistent);
+    bool hostname(const String &hostname);
+    bool setAutoReconnect(bool autoReconnect);
+    bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress());
+    wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+
+    wl_status_t status();
+    bool isConnected();
+
+    String SSID();
+    String psk();
+    uint8_t *BSSID();
+    String BSSIDstr();
+    int32_t channel();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t dnsNo = 0);
+    IPAddress softAPIP();
+
+    int hostByName(const char *hostName, IPAddress &result, uint32_t timeoutMs = 10000);
+
+    WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler);
+    WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler);
+    WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler);
+
+private:
+    uint8_t m_bssid[6];
+
+};
+
+extern ESP8266WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+
+public:
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void setTimeout(unsigned long timeout);
+
+};
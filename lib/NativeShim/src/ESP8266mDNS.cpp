@@ -0,0 +1,3 @@
+#include "ESP8266mDNS.h"
+
+MDNSResponder MDNS;
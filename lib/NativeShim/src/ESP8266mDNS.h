@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+class MDNSResponder {
+
+public:
+    bool begin(const String &hostname) {
+        return true;
+    }
+
+    void close() {
+    }
+
+    void update() {
+    }
+
+};
+
+extern MDNSResponder MDNS;
@@ -0,0 +1,136 @@
+#include "LittleFS.h"
+
+FS LittleFS;
+
+File::File() :
+    m_position(0),
+    m_erasedSector(-1),
+    m_open(false) {
+}
+
+File::File(const char *name, bool append) :
+    m_name(name),
+    m_position(append ? nativeHost.files[name].size() : 0),
+    m_erasedSector(-1),
+    m_open(true) {
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+    if (!m_open || size == 0) {
+        return 0;
+    }
+
+    // LittleFS never programs a written block again, the first write of a handle into a sector copies what the
+    // sector already holds into an erased one, further writes of the handle go into that sector until it is full
+    for (size_t sector = m_position / NATIVE_FLASH_SECTOR_SIZE; sector <= (m_position + size - 1) / NATIVE_FLASH_SECTOR_SIZE; sector++) {
+        if ((long) sector > m_erasedSector) {
+            nativeHost.flashSectorErases++;
+            m_erasedSector = sector;
+        }
+    }
+
+    std::string &data = nativeHost.files[m_name];
+    data.replace(m_position, std::min(size, data.size() - m_position), (const char *) buffer, size);
+    m_position += size;
+    nativeHost.fileBytesWritten += size;
+    return size;
+}
+
+int File::available() {
+    return m_open ? size() - m_position : 0;
+}
+
+int File::read() {
+    uint8_t c;
+
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+    size_t count = std::min(size, (size_t) available());
+
+    if (count > 0) {
+        memcpy(buffer, nativeHost.files[m_name].data() + m_position, count);
+        m_position += count;
+    }
+    return count;
+}
+
+bool File::seek(uint32_t position) {
+    if (!m_open || position > size()) {
+        return false;
+    }
+    m_position = position;
+    return true;
+}
+
+size_t File::position() {
+    return m_position;
+}
+
+size_t File::size() {
+    return m_open ? nativeHost.files[m_name].size() : 0;
+}
+
+void File::flush() {
+}
+
+void File::close() {
+    m_open = false;
+}
+
+File::operator bool() {
+    return m_open;
+}
+
+bool FS::begin() {
+    return true;
+}
+
+bool FS::format() {
+    nativeHost.files.clear();
+    return true;
+}
+
+bool FS::info(FSInfo &info) {
+    info = {1024 * 1024, 0, 8192, 256};
+    for (auto &file : nativeHost.files) {
+        info.usedBytes += file.second.size();
+    }
+    return true;
+}
+
+bool FS::exists(const char *path) {
+    return nativeHost.files.count(path) > 0;
+}
+
+File FS::open(const char *path, const char *mode) {
+    switch (mode[0]) {
+        case 'r':
+            return exists(path) ? File(path, false) : File();
+        case 'w':
+            nativeHost.files[path].clear();
+            return File(path, false);
+        case 'a':
+            return File(path, true);
+        default:
+            return File();
+    }
+}
+
+bool FS::remove(const char *path) {
+    return nativeHost.files.erase(path) > 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+    if (!exists(pathFrom)) {
+        return false;
+    }
+    nativeHost.files[pathTo] = nativeHost.files[pathFrom];
+    nativeHost.files.erase(pathFrom);
+    return true;
+}
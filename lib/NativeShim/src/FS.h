@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// files live in NativeHost::files, a handle only keeps the name, its read or write position and the last sector it erased
+class File : public Stream {
+
+public:
+    File();
+    File(const char *name, bool append);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    size_t read(uint8_t *buffer, size_t size);
+
+    bool seek(uint32_t position);
+    size_t position();
+    size_t size();
+    void flush();
+    void close();
+
+    operator bool();
+
+private:
+    std::string m_name;
+    size_t m_position;
+    long m_erasedSector;
+    bool m_open;
+
+};
+
+typedef struct {
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+} FSInfo;
+
+class FS {
+
+public:
+    bool begin();
+    bool format();
+    bool info(FSInfo &info);
+
+    bool exists(const char *path);
+    File open(const char *path, const char *mode);
+    bool remove(const char *path);
+    bool rename(const char *pathFrom, const char *pathTo);
+
+};
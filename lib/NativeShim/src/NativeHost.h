@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* size of a flash sector, the smallest unit the flash chip of the ESP8266 erases */
+#define NATIVE_FLASH_SECTOR_SIZE 4096
+
+typedef struct {
+    unsigned long millis;
+    uint8_t pin;
+    uint8_t value;
+} NativePinWrite;
+
+typedef struct {
+    unsigned long millis;
+    std::string topic;
+    std::string payload;
+    bool retain;
+} NativeMqttMessage;
+
+// state of the simulated device and its surroundings, tests drive the clock and inspect what the firmware did
+class NativeHost {
+
+public:
+    NativeHost();
+
+    void reset();
+
+    void setMillis(unsigned long ms);
+    void advanceMillis(unsigned long ms);
+    unsigned long getMillis();
+    unsigned long getMicros();
+
+    void writePin(uint8_t pin, uint8_t value);
+    uint8_t readPin(uint8_t pin);
+    const std::vector<NativePinWrite> &getPinWrites();
+    void clearPinWrites();
+
+    // messages are handed to the MQTT callback by PubSubClient::loop() once they are due
+    void receiveMqtt(unsigned long dueMillis, const std::string &topic, const std::string &payload);
+    bool popDueMqtt(NativeMqttMessage &message);
+    void publishMqtt(const std::string &topic, const std::string &payload, bool retain);
+    const std::vector<NativeMqttMessage> &getPublished();
+    void clearPublished();
+
+    void writeSerial(uint8_t c);
+    std::string takeSerial();
+
+    std::map<std::string, std::string> files;
+
+    // bytes written to all files and flash sectors erased for them since the reset, the flash wear of the firmware
+    unsigned long fileBytesWritten;
+    unsigned long flashSectorErases;
+
+private:
+    unsigned long m_micros;
+    uint8_t m_pins[32];
+    std::vector<NativePinWrite> m_pinWrites;
+    std::vector<NativeMqttMessage> m_inbound;
+    std::vector<NativeMqttMessage> m_published;
+    std::string m_serial;
+
+};
+
+extern NativeHost nativeHost;
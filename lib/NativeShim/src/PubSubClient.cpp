@@ -0,0 +1,112 @@
+#include "PubSubClient.h"
+
+PubSubClient::PubSubClient(WiFiClient &client) :
+    m_buffer(256),
+    m_connected(false),
+    m_publishRetained(false) {
+}
+
+PubSubClient &PubSubClient::setServer(IPAddress ip, uint16_t port) {
+    return *this;
+}
+
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port) {
+    return *this;
+}
+
+PubSubClient &PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+    this->callback = callback;
+    return *this;
+}
+
+PubSubClient &PubSubClient::setSocketTimeout(uint16_t timeout) {
+    return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+    m_buffer.resize(size);
+    return true;
+}
+
+uint16_t PubSubClient::getBufferSize() {
+    return m_buffer.size();
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession) {
+    m_connected = true;
+    m_subscriptions.clear();
+    return true;
+}
+
+void PubSubClient::disconnect() {
+    m_connected = false;
+}
+
+bool PubSubClient::connected() {
+    return m_connected;
+}
+
+int PubSubClient::state() {
+    return m_connected ? MQTT_CONNECTED : MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::subscribe(const char *topic) {
+    m_subscriptions.push_back(topic);
+    return m_connected;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+    if (!m_connected) {
+        return false;
+    }
+    nativeHost.publishMqtt(topic, payload, retained);
+    return true;
+}
+
+bool PubSubClient::beginPublish(const char *topic, unsigned int plength, bool retained) {
+    m_publishTopic = topic;
+    m_publishPayload.clear();
+    m_publishRetained = retained;
+    return m_connected;
+}
+
+int PubSubClient::endPublish() {
+    nativeHost.publishMqtt(m_publishTopic, m_publishPayload, m_publishRetained);
+    return 1;
+}
+
+size_t PubSubClient::write(uint8_t c) {
+    m_publishPayload += (char) c;
+    return 1;
+}
+
+size_t PubSubClient::write(const uint8_t *buffer, size_t size) {
+    m_publishPayload.append((const char *) buffer, size);
+    return size;
+}
+
+bool PubSubClient::loop() {
+    NativeMqttMessage message;
+
+    if (!m_connected) {
+        return false;
+    }
+
+    // like the real client one message per call, topic and payload are handed over in the client buffer
+    while (nativeHost.popDueMqtt(message)) {
+        size_t topicLength = message.topic.size();
+
+        if (std::find(m_subscriptions.begin(), m_subscriptions.end(), message.topic) == m_subscriptions.end() ||
+            topicLength + 1 + message.payload.size() > m_buffer.size()) {
+            continue;
+        }
+
+        memcpy(m_buffer.data(), message.topic.c_str(), topicLength + 1);
+        memcpy(m_buffer.data() + topicLength + 1, message.payload.data(), message.payload.size());
+        if (callback) {
+            callback((char *) m_buffer.data(), m_buffer.data() + topicLength + 1, message.payload.size());
+        }
+        break;
+    }
+    return true;
+}
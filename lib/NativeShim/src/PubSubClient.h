@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ESP8266WiFi.h>
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+// the broker is NativeHost: published messages are recorded there and due messages are delivered in loop()
+class PubSubClient : public Print {
+
+public:
+    PubSubClient(WiFiClient &client);
+
+    PubSubClient &setServer(IPAddress ip, uint16_t port);
+    PubSubClient &setServer(const char *domain, uint16_t port);
+    PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE);
+    PubSubClient &setSocketTimeout(uint16_t timeout);
+    bool setBufferSize(uint16_t size);
+    uint16_t getBufferSize();
+
+    bool connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage, bool cleanSession);
+    void disconnect();
+    bool connected();
+    int state();
+
+    bool subscribe(const char *topic);
+    bool publish(const char *topic, const char *payload, bool retained = false);
+    bool beginPublish(const char *topic, unsigned int plength, bool retained);
+    int endPublish();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    bool loop();
+
+private:
+    MQTT_CALLBACK_SIGNATURE;
+    std::vector<uint8_t> m_buffer;
+    std::vector<std::string> m_subscriptions;
+    bool m_connected;
+    std::string m_publishTopic;
+    std::string m_publishPayload;
+    bool m_publishRetained;
+
+};
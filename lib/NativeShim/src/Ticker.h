@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+// the onboard LED blinks only on the device, a ticker just remembers whether it is attached
+class Ticker {
+
+public:
+    Ticker() : m_active(false) {}
+
+    void attach_ms(uint32_t milliseconds, void (*callback)()) {
+        m_active = true;
+    }
+
+    void detach() {
+        m_active = false;
+    }
+
+    bool active() {
+        return m_active;
+    }
+
+private:
+    bool m_active;
+
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ESP8266WiFi.h>
+
+class WiFiManagerParameter {
+
+public:
+    WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length) :
+        m_value(defaultValue) {}
+
+    const char *getValue() {
+        return m_value.c_str();
+    }
+
+private:
+    std::string m_value;
+
+};
+
+// the portal is never shown, it connects right away and keeps the values it was given
+class WiFiManager {
+
+public:
+    void setAPCallback(void (*callback)(WiFiManager *)) {}
+    void setSaveConfigCallback(void (*callback)()) {}
+    void addParameter(WiFiManagerParameter *parameter) {}
+    void setTimeout(unsigned long seconds) {}
+    void resetSettings() {}
+
+    bool autoConnect() {
+        return true;
+    }
+
+    String getConfigPortalSSID() {
+        return String("native");
+    }
+
+};
@@ -0,0 +1,188 @@
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "LogBuffer.hpp"
+#include "ConfigStore.hpp"
+
+#define CONFIG_STORE_MAGIC 0x46434853
+
+ConfigStore configStore;
+
+void ConfigStore::setDefaults(DeviceSettings &settings, ShutterCalibration *calibration) {
+    memset(&settings, 0, sizeof(settings));
+    copyString(settings.mqttPort, sizeof(settings.mqttPort), "1883");
+    copyString(settings.discoveryPrefix, sizeof(settings.discoveryPrefix), "homeassistant");
+    copyString(settings.shutterDelay, sizeof(settings.shutterDelay), "1500");
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        const ShutterConfig &config = SHUTTER_CONFIG[i];
+
+        calibration[i] = {
+            (uint8_t) config.pinUp, (uint8_t) config.pinDown, (uint8_t) config.pinStop, 0,
+            config.durationUpMs, config.durationDownMs,
+            (uint16_t) config.pressTimeMs, (uint16_t) config.startLatencyMs, (uint16_t) config.stopLatencyMs, 0
+        };
+    }
+}
+
+bool ConfigStore::load(DeviceSettings &settings, ShutterCalibration *calibration) {
+    if (loadBinary(settings, calibration)) {
+        LOG_NOTICE("Read config [ %s ].", CONFIG_FILE);
+        return true;
+    }
+
+    if (!LittleFS.exists(CONFIG_JSON_FILE)) {
+        LOG_NOTICE("No config found, defaults are used.");
+        return false;
+    }
+
+    // the JSON config of former versions is converted once, it is only removed after the binary config was written
+    if (!migrateJson(settings)) {
+        LOG_ERROR("Failed to load JSON config file [ %s ], consider reset.", CONFIG_JSON_FILE);
+        return false;
+    }
+    if (save(settings, calibration)) {
+        LittleFS.remove(CONFIG_JSON_FILE);
+        LOG_NOTICE("Migrated JSON config file [ %s ] to [ %s ].", CONFIG_JSON_FILE, CONFIG_FILE);
+    }
+
+    return true;
+}
+
+bool ConfigStore::save(const DeviceSettings &settings, const ShutterCalibration *calibration) {
+    ConfigHeader header = {CONFIG_STORE_MAGIC, CONFIG_VERSION, SHUTTER_COUNT, 0};
+    uint32_t crc = 0;
+    bool success;
+
+    // written to a new file that replaces the config, a power loss keeps the old config instead of a torn one
+    File configFile = LittleFS.open(CONFIG_TEMP_FILE, "w");
+    if (!configFile) {
+        LOG_ERROR("Failed to open config [ %s ] for writing.", CONFIG_TEMP_FILE);
+        return false;
+    }
+
+    crc = updateCrc(crc, &header, sizeof(header));
+    crc = updateCrc(crc, &settings, sizeof(settings));
+    crc = updateCrc(crc, calibration, sizeof(ShutterCalibration) * SHUTTER_COUNT);
+
+    success = configFile.write((const uint8_t *) &header, sizeof(header)) == sizeof(header) &&
+              configFile.write((const uint8_t *) &settings, sizeof(settings)) == sizeof(settings) &&
+              configFile.write((const uint8_t *) calibration, sizeof(ShutterCalibration) * SHUTTER_COUNT) == sizeof(ShutterCalibration) * SHUTTER_COUNT &&
+              configFile.write((const uint8_t *) &crc, sizeof(crc)) == sizeof(crc);
+    configFile.close();
+
+    if (!success) {
+        LOG_ERROR("Failed to write config [ %s ].", CONFIG_TEMP_FILE);
+        LittleFS.remove(CONFIG_TEMP_FILE);
+        return false;
+    }
+
+    if (!LittleFS.rename(CONFIG_TEMP_FILE, CONFIG_FILE)) {
+        LOG_ERROR("Failed to replace config [ %s ].", CONFIG_FILE);
+        return false;
+    }
+    return true;
+}
+
+bool ConfigStore::loadBinary(DeviceSettings &settings, ShutterCalibration *calibration) {
+    ConfigHeader header;
+    DeviceSettings storedSettings;
+    ShutterCalibration storedCalibration[SHUTTER_COUNT];
+    ShutterCalibration entry;
+    uint32_t crc = 0;
+    uint32_t storedCrc;
+
+    File configFile = LittleFS.open(CONFIG_FILE, "r");
+    if (!configFile) {
+        return false;
+    }
+
+    if (configFile.read((uint8_t *) &header, sizeof(header)) != sizeof(header) ||
+        header.magic != CONFIG_STORE_MAGIC || header.version != CONFIG_VERSION ||
+        configFile.read((uint8_t *) &storedSettings, sizeof(storedSettings)) != sizeof(storedSettings)) {
+        configFile.close();
+        LOG_WARNING("Config [ %s ] has an unknown layout and is ignored.", CONFIG_FILE);
+        return false;
+    }
+    crc = updateCrc(crc, &header, sizeof(header));
+    crc = updateCrc(crc, &storedSettings, sizeof(storedSettings));
+
+    // shutters added to SHUTTER_CONFIG since the config was written keep their defaults, removed ones are skipped
+    memcpy(storedCalibration, calibration, sizeof(storedCalibration));
+    for (uint i = 0; i < header.shutterCount; i++) {
+        if (configFile.read((uint8_t *) &entry, sizeof(entry)) != sizeof(entry)) {
+            configFile.close();
+            LOG_WARNING("Config [ %s ] is truncated and ignored.", CONFIG_FILE);
+            return false;
+        }
+        crc = updateCrc(crc, &entry, sizeof(entry));
+        if (i < SHUTTER_COUNT) {
+            storedCalibration[i] = entry;
+        }
+    }
+
+    if (configFile.read((uint8_t *) &storedCrc, sizeof(storedCrc)) != sizeof(storedCrc) || storedCrc != crc) {
+        configFile.close();
+        LOG_WARNING("Config [ %s ] has an invalid CRC and is ignored.", CONFIG_FILE);
+        return false;
+    }
+    configFile.close();
+
+    // strings are terminated in case the record was written by a broken firmware, the CRC only covers the transfer
+    settings = storedSettings;
+    settings.mqttServer[sizeof(settings.mqttServer) - 1] = '\0';
+    settings.mqttPort[sizeof(settings.mqttPort) - 1] = '\0';
+    settings.mqttUser[sizeof(settings.mqttUser) - 1] = '\0';
+    settings.mqttPassword[sizeof(settings.mqttPassword) - 1] = '\0';
+    settings.discoveryPrefix[sizeof(settings.discoveryPrefix) - 1] = '\0';
+    settings.shutterDelay[sizeof(settings.shutterDelay) - 1] = '\0';
+    memcpy(calibration, storedCalibration, sizeof(storedCalibration));
+
+    return true;
+}
+
+bool ConfigStore::migrateJson(DeviceSettings &settings) {
+    File configFile = LittleFS.open(CONFIG_JSON_FILE, "r");
+    if (!configFile) {
+        return false;
+    }
+
+    // parsed straight from the file, the document is only needed once after an update of the firmware
+    DynamicJsonDocument json(1024);
+    DeserializationError deserializeError = deserializeJson(json, configFile);
+    configFile.close();
+
+    if (deserializeError) {
+        return false;
+    }
+
+    copyString(settings.mqttServer, sizeof(settings.mqttServer), json["mqtt_server"] | settings.mqttServer);
+    copyString(settings.mqttPort, sizeof(settings.mqttPort), json["mqtt_port"] | settings.mqttPort);
+    copyString(settings.mqttUser, sizeof(settings.mqttUser), json["mqtt_user"] | settings.mqttUser);
+    copyString(settings.mqttPassword, sizeof(settings.mqttPassword), json["mqtt_password"] | settings.mqttPassword);
+    copyString(settings.discoveryPrefix, sizeof(settings.discoveryPrefix), json["discovery_prefix"] | settings.discoveryPrefix);
+    copyString(settings.shutterDelay, sizeof(settings.shutterDelay), json["shutter_delay"] | settings.shutterDelay);
+
+    return true;
+}
+
+void ConfigStore::copyString(char *destination, size_t size, const char *source) {
+    // source and destination may be the same if a value is missing in the JSON config
+    if (destination != source) {
+        strncpy(destination, source, size - 1);
+    }
+    destination[size - 1] = '\0';
+}
+
+uint32_t ConfigStore::updateCrc(uint32_t crc, const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t *) data;
+
+    // bitwise CRC-32, the record is only checked once at boot so a lookup table is not worth its RAM
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (uint bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
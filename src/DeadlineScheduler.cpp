@@ -0,0 +1,111 @@
+#include <limits.h>
+#include "DeadlineScheduler.hpp"
+
+DeadlineScheduler::DeadlineScheduler() :
+    m_size(0) {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        m_heapIndex[i] = -1;
+    }
+}
+
+void DeadlineScheduler::schedule(uint id, ulong dueMillis) {
+    int index;
+
+    if (id >= SHUTTER_COUNT) {
+        return;
+    }
+
+    index = m_heapIndex[id];
+    if (index < 0) {
+        index = m_size++;
+        m_heap[index] = {dueMillis, (uint8_t) id};
+        m_heapIndex[id] = index;
+        siftUp(index);
+        return;
+    }
+
+    m_heap[index].dueMillis = dueMillis;
+    siftUp(index);
+    siftDown(m_heapIndex[id]);
+}
+
+void DeadlineScheduler::cancel(uint id) {
+    if (id < SHUTTER_COUNT && m_heapIndex[id] >= 0) {
+        remove(m_heapIndex[id]);
+    }
+}
+
+bool DeadlineScheduler::popDue(ulong nowMillis, uint &id) {
+    if (m_size == 0 || (long) (nowMillis - m_heap[0].dueMillis) < 0) {
+        return false;
+    }
+
+    id = m_heap[0].id;
+    remove(0);
+    return true;
+}
+
+ulong DeadlineScheduler::getNextDueInMs(ulong nowMillis) {
+    if (m_size == 0) {
+        return ULONG_MAX;
+    }
+
+    return (long) (m_heap[0].dueMillis - nowMillis) > 0 ? m_heap[0].dueMillis - nowMillis : 0;
+}
+
+bool DeadlineScheduler::isBefore(const Deadline &a, const Deadline &b) {
+    // deadlines are compared relative to each other, so the overflow of millis() does not matter
+    return (long) (a.dueMillis - b.dueMillis) < 0;
+}
+
+void DeadlineScheduler::swap(uint a, uint b) {
+    Deadline deadline = m_heap[a];
+
+    m_heap[a] = m_heap[b];
+    m_heap[b] = deadline;
+    m_heapIndex[m_heap[a].id] = a;
+    m_heapIndex[m_heap[b].id] = b;
+}
+
+void DeadlineScheduler::siftUp(uint index) {
+    while (index > 0 && isBefore(m_heap[index], m_heap[(index - 1) / 2])) {
+        swap(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+}
+
+void DeadlineScheduler::siftDown(uint index) {
+    uint smallest;
+
+    while (true) {
+        smallest = index;
+        if (2 * index + 1 < m_size && isBefore(m_heap[2 * index + 1], m_heap[smallest])) {
+            smallest = 2 * index + 1;
+        }
+        if (2 * index + 2 < m_size && isBefore(m_heap[2 * index + 2], m_heap[smallest])) {
+            smallest = 2 * index + 2;
+        }
+        if (smallest == index) {
+            return;
+        }
+
+        swap(index, smallest);
+        index = smallest;
+    }
+}
+
+void DeadlineScheduler::remove(uint index) {
+    uint last = --m_size;
+    uint8_t movedId = m_heap[last].id;
+
+    m_heapIndex[m_heap[index].id] = -1;
+    if (index == last) {
+        return;
+    }
+
+    // fill the gap with the last deadline and restore the heap order from there
+    m_heap[index] = m_heap[last];
+    m_heapIndex[movedId] = index;
+    siftUp(index);
+    siftDown(m_heapIndex[movedId]);
+}
@@ -0,0 +1,34 @@
+#include "LatencyHistogram.hpp"
+
+static const ulong BUCKET_LIMITS_US[LATENCY_HISTOGRAM_BUCKETS - 1] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::add(ulong durationUs) {
+    uint bucket = 0;
+
+    // the last bucket takes everything above the highest limit
+    while (bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && durationUs > BUCKET_LIMITS_US[bucket]) {
+        bucket++;
+    }
+
+    m_counts[bucket]++;
+    m_maxUs = max(m_maxUs, durationUs);
+}
+
+void LatencyHistogram::reset() {
+    for (uint i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        m_counts[i] = 0;
+    }
+    m_maxUs = 0;
+}
+
+ulong LatencyHistogram::getCount(uint bucket) {
+    return bucket < LATENCY_HISTOGRAM_BUCKETS ? m_counts[bucket] : 0;
+}
+
+ulong LatencyHistogram::getMaxUs() {
+    return m_maxUs;
+}
@@ -0,0 +1,265 @@
+#include <limits.h>
+#include <stdarg.h>
+#include "LogBuffer.hpp"
+
+LogBuffer logBuffer;
+
+LogBuffer::LogBuffer() :
+    m_output(NULL),
+    m_deferred(false),
+    m_head(0),
+    m_used(0),
+    m_droppedCount(0),
+    m_reportedDroppedCount(0) {
+}
+
+void LogBuffer::begin(Print *output) {
+    m_output = output;
+}
+
+void LogBuffer::setDeferred(bool deferred) {
+    m_deferred = deferred;
+    if (!m_deferred) {
+        drain(UINT_MAX);
+    }
+}
+
+ulong LogBuffer::getDroppedCount() {
+    return m_droppedCount;
+}
+
+bool LogBuffer::isEmpty() {
+    return m_used == 0;
+}
+
+void LogBuffer::write(const void *data, uint length) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint tail = (m_head + m_used) % LOG_BUFFER_SIZE;
+
+    for (uint i = 0; i < length; i++) {
+        m_buffer[tail] = bytes[i];
+        tail = (tail + 1) % LOG_BUFFER_SIZE;
+    }
+    m_used += length;
+}
+
+void LogBuffer::read(void *data, uint length) {
+    uint8_t *bytes = (uint8_t *) data;
+
+    for (uint i = 0; i < length; i++) {
+        bytes[i] = m_buffer[m_head];
+        m_head = (m_head + 1) % LOG_BUFFER_SIZE;
+    }
+    m_used -= length;
+}
+
+uint LogBuffer::packArgs(uint8_t *args, const char *format, va_list argList) {
+    uint length = 0;
+
+    // arguments are stored in the order of the format specifiers, strings are copied with a length prefix
+    for (const char *c = format; *c != '\0'; c++) {
+        if (*c != '%' || *(c + 1) == '\0') {
+            continue;
+        }
+        c++;
+
+        switch (*c) {
+            case 's': {
+                const char *str = va_arg(argList, const char *);
+                uint8_t strLength = str == NULL ? 0 : strnlen(str, LOG_STRING_MAX_LENGTH);
+
+                if (length + 1 + strLength > LOG_ARGS_MAX_LENGTH) {
+                    return length;
+                }
+                args[length++] = strLength;
+                memcpy(args + length, str, strLength);
+                length += strLength;
+                break;
+            }
+
+            case 'd':
+            case 'i':
+            case 'l':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'b':
+            case 'B':
+            case 'c':
+            case 't':
+            case 'T': {
+                int32_t value = (*c == 'l') ? (int32_t) va_arg(argList, long) : (int32_t) va_arg(argList, int);
+
+                if (length + sizeof(value) > LOG_ARGS_MAX_LENGTH) {
+                    return length;
+                }
+                memcpy(args + length, &value, sizeof(value));
+                length += sizeof(value);
+                break;
+            }
+
+            case 'F': {
+                float value = (float) va_arg(argList, double);
+
+                if (length + sizeof(value) > LOG_ARGS_MAX_LENGTH) {
+                    return length;
+                }
+                memcpy(args + length, &value, sizeof(value));
+                length += sizeof(value);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return length;
+}
+
+void LogBuffer::log(uint8_t level, const char *file, uint16_t line, const char *format, ...) {
+    LogRecordHeader header;
+    uint8_t args[LOG_ARGS_MAX_LENGTH];
+    va_list argList;
+
+    va_start(argList, format);
+    header.argsLength = packArgs(args, format, argList);
+    va_end(argList);
+
+    header.timestamp = millis();
+    header.file = file;
+    header.format = format;
+    header.line = line;
+    header.level = level;
+
+    if (m_used + sizeof(header) + header.argsLength > LOG_BUFFER_SIZE) {
+        m_droppedCount++;
+        return;
+    }
+
+    write(&header, sizeof(header));
+    write(args, header.argsLength);
+
+    if (!m_deferred) {
+        drain(UINT_MAX);
+    }
+}
+
+uint LogBuffer::drain(uint maxRecords) {
+    LogRecordHeader header;
+    uint8_t args[LOG_ARGS_MAX_LENGTH];
+    uint records = 0;
+
+    if (m_output == NULL) {
+        return records;
+    }
+
+    if (m_droppedCount != m_reportedDroppedCount) {
+        m_output->print("Log buffer full, records dropped: ");
+        m_output->print(m_droppedCount - m_reportedDroppedCount);
+        m_output->print('\n');
+        m_reportedDroppedCount = m_droppedCount;
+    }
+
+    while (!isEmpty() && records < maxRecords) {
+        read(&header, sizeof(header));
+        read(args, header.argsLength);
+        printRecord(header, args);
+        records++;
+    }
+
+    return records;
+}
+
+char LogBuffer::getLevelChar(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_FATAL:
+            return 'F';
+        case LOG_LEVEL_ERROR:
+            return 'E';
+        case LOG_LEVEL_WARNING:
+            return 'W';
+        case LOG_LEVEL_NOTICE:
+            return 'N';
+        case LOG_LEVEL_TRACE:
+            return 'T';
+        default:
+            return 'V';
+    }
+}
+
+void LogBuffer::printRecord(const LogRecordHeader &header, const uint8_t *args) {
+    char prefix[16];
+    uint offset = 0;
+
+    snprintf(prefix, sizeof(prefix), "%10lu ", header.timestamp);
+    m_output->print(prefix);
+    m_output->print(getLevelChar(header.level));
+    m_output->print(": [ ");
+    m_output->print(header.file);
+    m_output->print(':');
+    m_output->print(header.line);
+    m_output->print(" ] ");
+
+    for (const char *c = header.format; *c != '\0'; c++) {
+        if (*c != '%' || *(c + 1) == '\0') {
+            m_output->print(*c);
+            continue;
+        }
+        c++;
+
+        if (*c == 's') {
+            uint8_t strLength = offset < header.argsLength ? args[offset++] : 0;
+
+            m_output->write(args + offset, strLength);
+            offset += strLength;
+        } else if (*c == 'F') {
+            float value = 0;
+
+            if (offset + sizeof(value) <= header.argsLength) {
+                memcpy(&value, args + offset, sizeof(value));
+                offset += sizeof(value);
+            }
+            m_output->print(value);
+        } else if (strchr("dilxXbBctTu", *c) != NULL) {
+            int32_t value = 0;
+
+            if (offset + sizeof(value) <= header.argsLength) {
+                memcpy(&value, args + offset, sizeof(value));
+                offset += sizeof(value);
+            }
+
+            switch (*c) {
+                case 'x':
+                case 'X':
+                    m_output->print("0x");
+                    m_output->print((ulong) value, HEX);
+                    break;
+                case 'b':
+                case 'B':
+                    m_output->print("0b");
+                    m_output->print((ulong) value, BIN);
+                    break;
+                case 'c':
+                    m_output->print((char) value);
+                    break;
+                case 't':
+                    m_output->print(value ? 'T' : 'F');
+                    break;
+                case 'T':
+                    m_output->print(value ? "true" : "false");
+                    break;
+                case 'u':
+                    m_output->print((ulong) value);
+                    break;
+                default:
+                    m_output->print((long) value);
+                    break;
+            }
+        } else {
+            m_output->print(*c);
+        }
+    }
+
+    m_output->print('\n');
+}
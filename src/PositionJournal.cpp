@@ -0,0 +1,201 @@
+#include <LittleFS.h>
+#include "LogBuffer.hpp"
+#include "PositionJournal.hpp"
+
+#define JOURNAL_RECORD_MARKER 0xA5
+
+PositionJournal positionJournal;
+
+PositionJournal::PositionJournal() :
+    m_recordCount(0) {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        m_entries[i] = {false, false, 100, ShutterAction::UNDEFINED_ACTION};
+    }
+}
+
+void PositionJournal::begin() {
+    JournalRecord records[POSITION_JOURNAL_READ_CHUNK];
+    size_t bytesRead;
+    bool torn = false;
+
+    m_recordCount = 0;
+
+    File journalFile = LittleFS.open(POSITION_JOURNAL_FILE, "r");
+    if (!journalFile) {
+        LOG_NOTICE("Position journal [ %s ] does not exist.", POSITION_JOURNAL_FILE);
+        return;
+    }
+
+    // the journal is compacted before it exceeds its maximum size, so reading it is bounded as well
+    while (!torn && m_recordCount < POSITION_JOURNAL_MAX_RECORDS) {
+        bytesRead = journalFile.read((uint8_t *) records, sizeof(records));
+        if (bytesRead == 0) {
+            break;
+        }
+        torn = (bytesRead % sizeof(JournalRecord)) != 0;
+
+        for (uint i = 0; i < bytesRead / sizeof(JournalRecord); i++) {
+            // a record torn by a power loss ends the journal, everything before it is consistent
+            if (!isValid(records[i])) {
+                torn = true;
+                break;
+            }
+
+            m_entries[records[i].shutterIndex] = {true, false, records[i].position, (ShutterAction) records[i].moveAction};
+            m_recordCount++;
+        }
+    }
+    journalFile.close();
+
+    LOG_NOTICE("Read [ %d ] records from position journal [ %s ].", m_recordCount, POSITION_JOURNAL_FILE);
+
+    if (torn || m_recordCount >= POSITION_JOURNAL_MAX_RECORDS) {
+        compact();
+    }
+}
+
+bool PositionJournal::getPosition(uint shutterIndex, uint &position) {
+    if (shutterIndex >= SHUTTER_COUNT || !m_entries[shutterIndex].valid) {
+        return false;
+    }
+
+    // a move still in flight was never stopped, so the shutter ran into its end position
+    switch (m_entries[shutterIndex].moveAction) {
+        case ShutterAction::UP:
+            position = 100;
+            break;
+        case ShutterAction::DOWN:
+            position = 0;
+            break;
+        default:
+            position = m_entries[shutterIndex].position;
+            break;
+    }
+
+    return true;
+}
+
+void PositionJournal::recordMove(uint shutterIndex, uint position, ShutterAction moveAction) {
+    record(shutterIndex, position, moveAction);
+}
+
+void PositionJournal::recordPosition(uint shutterIndex, uint position) {
+    record(shutterIndex, position, ShutterAction::UNDEFINED_ACTION);
+}
+
+void PositionJournal::record(uint shutterIndex, uint position, ShutterAction moveAction) {
+    if (shutterIndex >= SHUTTER_COUNT) {
+        return;
+    }
+
+    JournalEntry &entry = m_entries[shutterIndex];
+
+    // unchanged state does not cost a flash write, changes are only written by flush() and the latest one wins
+    if (entry.valid && entry.position == position && entry.moveAction == moveAction) {
+        return;
+    }
+    entry = {true, true, (uint8_t) position, moveAction};
+}
+
+bool PositionJournal::isFlushPending() {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (m_entries[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PositionJournal::flush() {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (!m_entries[i].pending) {
+            continue;
+        }
+
+        if (m_recordCount >= POSITION_JOURNAL_MAX_RECORDS) {
+            // the compacted journal holds the state of all shutters, nothing is left to append
+            compact();
+            return;
+        }
+
+        m_entries[i].pending = false;
+        if (append(createRecord(i))) {
+            m_recordCount++;
+        }
+    }
+}
+
+bool PositionJournal::append(const JournalRecord &record) {
+    File journalFile = LittleFS.open(POSITION_JOURNAL_FILE, "a");
+    bool success;
+
+    if (!journalFile) {
+        LOG_ERROR("Failed to open position journal [ %s ] for appending.", POSITION_JOURNAL_FILE);
+        return false;
+    }
+
+    success = journalFile.write((const uint8_t *) &record, sizeof(record)) == sizeof(record);
+    journalFile.close();
+
+    if (!success) {
+        LOG_ERROR("Failed to append to position journal [ %s ].", POSITION_JOURNAL_FILE);
+    }
+    return success;
+}
+
+void PositionJournal::compact() {
+    JournalRecord record;
+    uint recordCount = 0;
+
+    // write the current state to a new file and replace the journal with it, a power loss keeps the old journal
+    File compactFile = LittleFS.open(POSITION_JOURNAL_COMPACT_FILE, "w");
+    if (!compactFile) {
+        LOG_ERROR("Failed to open [ %s ] to compact the position journal.", POSITION_JOURNAL_COMPACT_FILE);
+        return;
+    }
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (!m_entries[i].valid) {
+            continue;
+        }
+
+        record = createRecord(i);
+        compactFile.write((const uint8_t *) &record, sizeof(record));
+        recordCount++;
+    }
+    compactFile.close();
+
+    if (!LittleFS.rename(POSITION_JOURNAL_COMPACT_FILE, POSITION_JOURNAL_FILE)) {
+        LOG_ERROR("Failed to replace position journal [ %s ].", POSITION_JOURNAL_FILE);
+        return;
+    }
+
+    m_recordCount = recordCount;
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        m_entries[i].pending = false;
+    }
+    LOG_NOTICE("Compacted position journal [ %s ] to [ %d ] records.", POSITION_JOURNAL_FILE, m_recordCount);
+}
+
+PositionJournal::JournalRecord PositionJournal::createRecord(uint shutterIndex) {
+    JournalRecord record;
+
+    record.marker = JOURNAL_RECORD_MARKER;
+    record.shutterIndex = shutterIndex;
+    record.position = m_entries[shutterIndex].position;
+    record.moveAction = (int8_t) m_entries[shutterIndex].moveAction;
+    record.checksum = getChecksum(record);
+
+    return record;
+}
+
+uint8_t PositionJournal::getChecksum(const JournalRecord &record) {
+    return ~(record.marker + record.shutterIndex + record.position + (uint8_t) record.moveAction);
+}
+
+bool PositionJournal::isValid(const JournalRecord &record) {
+    return record.marker == JOURNAL_RECORD_MARKER &&
+           record.shutterIndex < SHUTTER_COUNT &&
+           record.position <= 100 &&
+           record.checksum == getChecksum(record);
+}
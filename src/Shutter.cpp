@@ -1,81 +1,79 @@
-#include <ArduinoLog.h>
+#include <limits.h>
+#include "LogBuffer.hpp"
 #include "Shutter.hpp"
 
 Shutter::Shutter(String id) : 
-    m_pinUp(0),
-    m_pinDown(0),
-    m_pinStop(0),
-    m_durationFullMoveMs(20000),
+    m_pins{0, 0, 0},
+    m_pressTimeMs(100),
+    m_durationUpMs(20000),
+    m_durationDownMs(20000),
+    m_startLatencyMs(0),
+    m_stopLatencyMs(0),
     m_lastButtonPressMs(0),
     m_position(100) {
     m_id = id;
     resetTask();
 }
 
-int Shutter::roundUp(int numToRound, int multiple) {
-    if (multiple == 0)
-        return numToRound;
-
-    int remainder = numToRound % multiple;
-    if (remainder == 0)
-        return numToRound;
-
-    return numToRound + multiple - remainder;
-}
-
 String Shutter::getID() {
     return m_id;
 }
 
+void Shutter::setID(String id) {
+    m_id = id;
+}
+
 void Shutter::setupPin(uint pin) {
     pinMode(pin, OUTPUT);
     digitalWrite(LED_BUILTIN, LOW);
 }
 
 void Shutter::setControlPins(uint pinUp, uint pinDown, uint pinStop) {
-    m_pinUp = pinUp;
-    setupPin(m_pinUp);
-
-    m_pinDown = pinDown;
-    setupPin(m_pinDown);
+    m_pins[0] = pinUp;
+    m_pins[1] = pinDown;
+    m_pins[2] = pinStop;
 
-    m_pinStop = pinStop;
-    setupPin(m_pinStop);
+    for (uint pin : m_pins) {
+        setupPin(pin);
+    }
 
-    Log.notice("[ %s:%d ] [ %s ] Pin setup complete with up [ %d ], down [ %d ], stop [ %d ].", __FILE__, __LINE__, m_id.c_str(), m_pinUp, m_pinDown, m_pinStop);
+    LOG_NOTICE("[ %s ] Pin setup complete with up [ %d ], down [ %d ], stop [ %d ].", m_id.c_str(), pinUp, pinDown, pinStop);
 }
 
 void Shutter::setDurationFullMoveMs(uint ms) {
-    m_durationFullMoveMs = ms;
-    Log.notice("[ %s:%d ] [ %s ] Received duration for full shutter move [ %dms ].", __FILE__, __LINE__, m_id.c_str(), m_durationFullMoveMs);
+    setDurationFullMoveMs(ms, ms);
 }
 
-void Shutter::setDelayTimeMs(uint ms) {
-    m_delayTimeMs = ms;
-    Log.notice("[ %s:%d ] [ %s ] Received delay time required before next action can be executed [ %dms ].", __FILE__, __LINE__, m_id.c_str(), m_delayTimeMs);
+void Shutter::setDurationFullMoveMs(uint upMs, uint downMs) {
+    m_durationUpMs = upMs;
+    m_durationDownMs = downMs;
+    LOG_NOTICE("[ %s ] Received duration for full shutter move up [ %dms ] and down [ %dms ].", m_id.c_str(), m_durationUpMs, m_durationDownMs);
 }
 
-uint Shutter::getPin(ShutterAction shutterAction) {
-    uint pin = 0;
+void Shutter::setMotorLatencyMs(uint startMs, uint stopMs) {
+    m_startLatencyMs = startMs;
+    m_stopLatencyMs = stopMs;
+    LOG_NOTICE("[ %s ] Received motor latency after button press for start [ %dms ] and stop [ %dms ].", m_id.c_str(), m_startLatencyMs, m_stopLatencyMs);
+}
 
-    switch (shutterAction) {
-        case ShutterAction::UP:
-            pin = m_pinUp;
-            break;
-    
-        case ShutterAction::DOWN:
-            pin = m_pinDown;
-            break;
+void Shutter::setDelayTimeMs(uint ms) {
+    m_delayTimeMs = ms;
+    LOG_NOTICE("[ %s ] Received delay time required before next action can be executed [ %dms ].", m_id.c_str(), m_delayTimeMs);
+}
 
-        case ShutterAction::STOP:
-            pin = m_pinStop;
-            break;
+void Shutter::setPressTimeMs(uint ms) {
+    m_pressTimeMs = ms;
+    LOG_NOTICE("[ %s ] Received press time for remote control buttons [ %dms ].", m_id.c_str(), m_pressTimeMs);
+}
 
-        default:
-            break;
-    }
+void Shutter::restorePosition(uint position) {
+    m_position = min((int) position, 100);
+    LOG_NOTICE("[ %s ] Restored position [ %d ].", m_id.c_str(), m_position);
+}
 
-    return pin;
+uint Shutter::getPin(ShutterAction shutterAction) {
+    // only UP, DOWN and STOP press a button, they are numbered consecutively starting with UP
+    return m_pins[(int) shutterAction - (int) ShutterAction::UP];
 }
 
 uint Shutter::getNewPosition(ShutterAction shutterAction) {
@@ -103,6 +101,12 @@ void Shutter::resetTask() {
     m_task.newPosition = 0;
     m_task.shutterAction = ShutterAction::UNDEFINED_ACTION;
     m_task.stopRequiredAfterMillis = 0;
+    m_task.pressStartMillis = 0;
+    m_task.pressReleaseMillis = 0;
+    m_task.moveStartMillis = 0;
+    m_task.moveAction = ShutterAction::UNDEFINED_ACTION;
+    m_task.followUpPosition = -1;
+    m_task.stopPressRequired = true;
     m_task.reportProgressBegin = true;
 }
 
@@ -110,11 +114,103 @@ uint Shutter::getPosition() {
     return m_position;
 }
 
-bool Shutter::setPosition(uint position) {
+uint Shutter::getTravelMs(ShutterAction direction, uint percent) {
+    return (percent * (direction == ShutterAction::UP ? m_durationUpMs : m_durationDownMs)) / 100;
+}
+
+ulong Shutter::getStopPressMillis(uint position, bool stopPressRequired) {
+    // the motor keeps running for the stop latency after STOP is pressed, so press it that much earlier
+    ulong stopMillis = m_task.moveStartMillis + getTravelMs(m_task.moveAction, abs((int) m_position - (int) position));
+
+    if (stopPressRequired) {
+        stopMillis -= m_stopLatencyMs;
+    }
+
+    return (long) (stopMillis - millis()) > 0 ? stopMillis : millis();
+}
+
+uint Shutter::getPositionAt(ulong timeMillis) {
+    long elapsedMs;
+    uint movedPercent;
+
+    if (m_task.moveStartMillis == 0) {
+        return m_position;
+    }
+
+    // the motor only starts after its start latency, until then the shutter remains in place
+    elapsedMs = (long) (timeMillis - m_task.moveStartMillis);
+    if (elapsedMs <= 0) {
+        return m_position;
+    }
+
+    movedPercent = min((ulong) 100, ((ulong) elapsedMs * 100) / getTravelMs(m_task.moveAction, 100));
+
+    if (m_task.moveAction == ShutterAction::DOWN) {
+        return movedPercent >= m_position ? 0 : m_position - movedPercent;
+    }
+    return min(m_position + movedPercent, (uint) 100);
+}
+
+uint Shutter::getEstimatedPosition() {
+    return getPositionAt(millis());
+}
+
+bool Shutter::isMoving() {
+    // shutter was started and is waiting for the STOP (or the end position) which ends the move
+    return m_task.moveStartMillis > 0 && 
+           m_task.pressStartMillis == 0 &&
+           m_task.shutterAction == ShutterAction::STOP;
+}
+
+bool Shutter::retarget(int position, ulong stopMillis) {
+    uint currentPosition = getEstimatedPosition();
+    bool sameDirection;
+
+    // a negative position only stops the shutter
+    position = min(position, 100);
+    sameDirection = (m_task.moveAction == ShutterAction::DOWN && position >= 0 && position < (int) currentPosition) ||
+                    (m_task.moveAction == ShutterAction::UP && position > (int) currentPosition);
+
+    if (sameDirection) {
+        // keep moving, only reschedule the STOP for the new position, at the end position no STOP is pressed
+        m_task.stopPressRequired = (position > 0 && position < 100);
+        m_task.executionTimeMillis = getStopPressMillis(position, m_task.stopPressRequired);
+        m_task.newPosition = position;
+        m_task.followUpPosition = -1;
+
+        LOG_NOTICE("[ %s ] Retarget to position [ %d ] in same direction, estimated pos [ %d ], STOP rescheduled at [ %l ].", m_id.c_str(), position, currentPosition, m_task.executionTimeMillis);
+    } else {
+        // target is behind the shutter, stop as requested and continue with the new position afterwards
+        m_task.executionTimeMillis = stopMillis;
+        m_task.newPosition = getPositionAt(stopMillis + m_stopLatencyMs);
+        m_task.stopPressRequired = true;
+        m_task.followUpPosition = (position == (int) m_task.newPosition ? -1 : position);
+
+        LOG_NOTICE("[ %s ] Retarget to position [ %d ] requires STOP at estimated pos [ %d ], follow up position [ %d ].", m_id.c_str(), position, m_task.newPosition, m_task.followUpPosition);
+    }
+
+    return true;
+}
+
+void Shutter::scheduleAction(ShutterAction shutterAction, ulong executionTimeMillis) {
+    resetTask();
+    m_task.executionTimeMillis = executionTimeMillis;
+    m_task.shutterAction = shutterAction;
+    m_task.newPosition = getNewPosition(m_task.shutterAction);
+
+    if (m_task.shutterAction == ShutterAction::UP || m_task.shutterAction == ShutterAction::DOWN) {
+        // no STOP required at the end position, but keep track of the move until it is reached
+        m_task.stopRequiredAfterMillis = getTravelMs(m_task.shutterAction, abs((int) m_position - (int) m_task.newPosition));
+        m_task.stopPressRequired = false;
+    }
+    
+    LOG_NOTICE("[ %s ] Scheduled task with action [ %d ], new position [ %d ], no STOP required.", m_id.c_str(), m_task.shutterAction, m_task.newPosition);
+}
+
+bool Shutter::setPosition(uint position, ulong executionTimeMillis) {
     bool success = true;
 
     int diffMovePercenct;
-    uint newPositionPercent;
     ShutterAction shutterAction;
     
     position = min((int) position, 100);
@@ -122,104 +218,214 @@ bool Shutter::setPosition(uint position) {
 
     if (diffMovePercenct > 0) {
         shutterAction = ShutterAction::DOWN;
-        newPositionPercent = m_position - roundUp(diffMovePercenct, 10);
-        diffMovePercenct = m_position - newPositionPercent;
     } else if (diffMovePercenct < 0) {
         shutterAction = ShutterAction::UP;
-        newPositionPercent = m_position + roundUp(abs(diffMovePercenct), 10);
-        diffMovePercenct = newPositionPercent - m_position;
     } else {
-        // no difference detected, leave everything as is
-        for (auto callback : m_onActionCompleteUserCallbacks) {
+        // no difference detected, leave everything as is, only a planned task is dropped
+        resetTask();
+        for (auto &callback : m_onActionCompleteUserCallbacks) {
             callback(m_id, ShutterAction::MOVE_BY_POSITION, ShutterReason::SUCCESS);
         }
         return success;
     }
 
-    if (newPositionPercent <= 0 || newPositionPercent >= 100) {
-        // full move (to the end) without stop, use executeAction function
-        return executeAction(shutterAction);
+    if (position <= 0 || position >= 100) {
+        // full move (to the end) without stop
+        scheduleAction(shutterAction, executionTimeMillis);
+        return success;
     }
 
     resetTask();
-    m_task.executionTimeMillis = millis();
-    m_task.newPosition = newPositionPercent;
+    m_task.executionTimeMillis = executionTimeMillis;
+    m_task.newPosition = position;
     m_task.shutterAction = shutterAction;
-    m_task.stopRequiredAfterMillis = (abs(diffMovePercenct) * m_durationFullMoveMs) / 100;
+    m_task.stopRequiredAfterMillis = getTravelMs(shutterAction, abs(diffMovePercenct));
 
-    Log.notice("[ %s:%d ] [ %s ] Calculation for new position completed. Action [ %d ], Old pos [ %d ], new pos [ %d ], diff [ %d ], time to move [ %dms ].", __FILE__, __LINE__, m_id.c_str(), m_task.shutterAction, m_position, m_task.newPosition, diffMovePercenct, m_task.stopRequiredAfterMillis);        
+    LOG_NOTICE("[ %s ] Calculation for new position completed. Action [ %d ], Old pos [ %d ], new pos [ %d ], diff [ %d ], time to move [ %dms ].", m_id.c_str(), m_task.shutterAction, m_position, m_task.newPosition, diffMovePercenct, m_task.stopRequiredAfterMillis);        
 
     return success;
 }
 
-String Shutter::getStatus() {
+const char *Shutter::getStatus() {
+    if (m_task.moveStartMillis > 0) {
+        return m_task.moveAction == ShutterAction::UP ? "opening" : "closing";
+    }
     return m_position == 0 ? "closed" : "open";
 }
 
+bool Shutter::getNextActionMillis(ulong &dueMillis) {
+    if (m_task.pressStartMillis > 0) {
+        dueMillis = m_task.pressReleaseMillis;
+    } else if (m_task.executionTimeMillis > 0) {
+        dueMillis = m_task.executionTimeMillis;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+ulong Shutter::getNextActionInMs() {
+    ulong dueMillis;
+
+    if (!getNextActionMillis(dueMillis)) {
+        return ULONG_MAX;
+    }
+
+    return (long) (dueMillis - millis()) > 0 ? dueMillis - millis() : 0;
+}
+
+ulong Shutter::getIdleMillis() {
+    return m_lastButtonPressMs + m_delayTimeMs;
+}
+
+bool Shutter::isButtonPressed() {
+    return m_task.pressStartMillis > 0;
+}
+
 bool Shutter::isActionInProgress() {
     return (m_task.executionTimeMillis > 0) || 
            (millis() - m_lastButtonPressMs < m_delayTimeMs);
 }
 
 bool Shutter::executeAction(ShutterAction shutterAction, uint position) {
+    return executeActionAt(shutterAction, position, millis());
+}
+
+bool Shutter::executeActionAt(ShutterAction shutterAction, uint position, ulong executionTimeMillis) {
     bool success = true;
 
-    if (isActionInProgress()) {
-        Log.warning("[ %s:%d ] [ %s ] Device currently busy with other task, cannot proceed with action [ %d ].", __FILE__, __LINE__, m_id.c_str(), shutterAction);
+    if (shutterAction == ShutterAction::STOP) {
+        success = stop(executionTimeMillis);
+    } else if (isMoving()) {
+        // new command while the shutter is moving, adjust the running move instead of rejecting it
+        if (shutterAction == ShutterAction::MOVE_BY_POSITION) {
+            success = retarget(position, executionTimeMillis);
+        } else {
+            success = retarget(getNewPosition(shutterAction), executionTimeMillis);
+        }
+    } else if (m_task.pressStartMillis > 0 || (long) (executionTimeMillis - getIdleMillis()) < 0) {
+        LOG_WARNING("[ %s ] Device currently busy with other task, cannot proceed with action [ %d ].", m_id.c_str(), shutterAction);
         
         success = false;
-        for (auto callback : m_onActionCompleteUserCallbacks) {
+        for (auto &callback : m_onActionCompleteUserCallbacks) {
             callback(m_id, shutterAction, ShutterReason::DEVICE_BUSY);
         }
     } else {
+        // a planned task no button was pressed for yet is simply replaced, last writer wins
+        if (m_task.executionTimeMillis > 0) {
+            LOG_NOTICE("[ %s ] Planned task with action [ %d ] replaced by action [ %d ].", m_id.c_str(), m_task.shutterAction, shutterAction);
+        }
+
         if (shutterAction == ShutterAction::MOVE_BY_POSITION) {
-            setPosition(position);
+            setPosition(position, executionTimeMillis);
         } else {
-            resetTask();
-            m_task.executionTimeMillis = millis();
-            m_task.shutterAction = shutterAction;
-            m_task.newPosition = getNewPosition(m_task.shutterAction);
-            
-            Log.notice("[ %s:%d ] [ %s ] Scheduled task with action [ %d ], new position [ %d ], no STOP required.", __FILE__, __LINE__, m_id.c_str(), m_task.shutterAction, m_task.newPosition);
+            scheduleAction(shutterAction, executionTimeMillis);
         }
     }
 
     return success;
 }
 
+bool Shutter::stop(ulong stopMillis) {
+    // STOP is never rejected, it preempts whatever the shutter is doing
+    if (m_task.pressStartMillis > 0) {
+        // a button is held right now, it is released as planned but nothing follows up on it
+        m_task.followUpPosition = -1;
+        if (m_task.stopRequiredAfterMillis > 0) {
+            // the move starts with the release, so stop it right after at the position it started from
+            m_task.newPosition = m_position;
+            m_task.stopPressRequired = true;
+        }
+        LOG_NOTICE("[ %s ] STOP while button for action [ %d ] is held, stop right after its release.", m_id.c_str(), m_task.shutterAction);
+    } else if (isMoving()) {
+        retarget(-1, stopMillis);
+    } else if (m_task.executionTimeMillis > 0) {
+        // nothing moves yet, simply drop the planned task
+        LOG_NOTICE("[ %s ] STOP drops planned task with action [ %d ].", m_id.c_str(), m_task.shutterAction);
+        resetTask();
+        for (auto &callback : m_onActionCompleteUserCallbacks) {
+            callback(m_id, ShutterAction::STOP, ShutterReason::SUCCESS);
+        }
+    } else {
+        // the shutter might have been moved with another remote, so press STOP even within the hold-off
+        scheduleAction(ShutterAction::STOP, stopMillis);
+    }
+
+    return true;
+}
+
+void Shutter::pressButton() {
+    uint pin = getPin(m_task.shutterAction);
+
+    digitalWrite(pin, HIGH);
+    m_task.pressStartMillis = millis();
+    m_task.pressReleaseMillis = m_task.pressStartMillis + m_pressTimeMs;
+}
+
+void Shutter::releaseButton() {
+    uint pin = getPin(m_task.shutterAction);
+    ulong pressStartMillis = m_task.pressStartMillis;
+
+    digitalWrite(pin, LOW);
+    m_lastButtonPressMs = millis();
+    m_task.pressStartMillis = 0;
+    m_task.pressReleaseMillis = 0;
+
+    if (m_task.stopRequiredAfterMillis > 0) {
+        // the motor starts its start latency after the button was pressed, not when it is released
+        m_task.moveStartMillis = pressStartMillis + m_startLatencyMs;
+        m_task.moveAction = m_task.shutterAction;
+        m_task.shutterAction = ShutterAction::STOP;
+        m_task.executionTimeMillis = getStopPressMillis(m_task.newPosition, m_task.stopPressRequired);
+        m_task.stopRequiredAfterMillis = 0;
+        m_task.reportProgressBegin = false;
+        //m_task.newPosition = remain untouched as it is set in the next loop
+
+        LOG_NOTICE("[ %s ] Schedule required STOP task in [ %dms ] to reach new position [ %d ].", m_id.c_str(), m_task.executionTimeMillis, m_task.newPosition);
+    } else {
+        finishTask();
+    }
+}
+
+void Shutter::finishTask() {
+    LOG_NOTICE("[ %s ] Scheduled task finished for action [ %d ], new position [ %d ].", m_id.c_str(), m_task.shutterAction, m_task.newPosition);
+    
+    int followUpPosition = m_task.followUpPosition;
+
+    m_position = m_task.newPosition;
+    resetTask();
+    if (followUpPosition >= 0) {
+        // shutter was stopped to reverse, move to the requested position once the remote is ready again
+        setPosition(followUpPosition, m_lastButtonPressMs + m_delayTimeMs);
+    }
+    for (auto &callback : m_onActionCompleteUserCallbacks) {
+        callback(m_id, m_task.shutterAction, ShutterReason::SUCCESS);
+    }
+}
+
 void Shutter::tick() {
-    if (m_task.executionTimeMillis > 0 && 
-        (long) millis() - (long) m_task.executionTimeMillis >= 0) {
-        Log.notice("[ %s:%d ] [ %s ] Execute scheduled task with action [ %d ], new position [ %d ], report progress begin [ %T ].", __FILE__, __LINE__, m_id.c_str(), m_task.shutterAction, m_task.newPosition, m_task.reportProgressBegin);
+    if (m_task.pressStartMillis > 0) {
+        // button is currently held, release it once the press time is over
+        if ((long) (millis() - m_task.pressReleaseMillis) >= 0) {
+            releaseButton();
+        }
+    } else if (m_task.executionTimeMillis > 0 && 
+        (long) (millis() - m_task.executionTimeMillis) >= 0) {
+        LOG_NOTICE("[ %s ] Execute scheduled task with action [ %d ], new position [ %d ], report progress begin [ %T ].", m_id.c_str(), m_task.shutterAction, m_task.newPosition, m_task.reportProgressBegin);
         
         if (m_task.reportProgressBegin) {
-            for (auto callback : m_onActionInProgressUserCallbacks) {
+            for (auto &callback : m_onActionInProgressUserCallbacks) {
                 callback(m_id, m_task.shutterAction);
             }
         }
 
-        uint pin = getPin(m_task.shutterAction);
-        digitalWrite(pin, HIGH);
-        delay(100);
-        digitalWrite(pin, LOW);
-        m_lastButtonPressMs = millis();
-
-        if (m_task.stopRequiredAfterMillis > 0) {
-            m_task.shutterAction = ShutterAction::STOP;
-            m_task.executionTimeMillis = millis() + m_task.stopRequiredAfterMillis;
-            m_task.stopRequiredAfterMillis = 0;
-            m_task.reportProgressBegin = false;
-            //m_task.newPosition = remain untouched as it is set in the next loop
-
-            Log.notice("[ %s:%d ] [ %s ] Schedule required STOP task in [ %dms ] to reach new position [ %d ].", __FILE__, __LINE__, m_id.c_str(), m_task.executionTimeMillis, m_task.newPosition);
+        // the button of a move is always pressed, only the STOP at the end position is left out
+        if (m_task.shutterAction != ShutterAction::STOP || m_task.stopPressRequired) {
+            pressButton();
         } else {
-            Log.notice("[ %s:%d ] [ %s ] Scheduled task finished for action [ %d ], new position [ %d ].", __FILE__, __LINE__, m_id.c_str(), m_task.shutterAction, m_task.newPosition);
-            
-            m_position = m_task.newPosition;
-            resetTask();
-            for (auto callback : m_onActionCompleteUserCallbacks) {
-                callback(m_id, m_task.shutterAction, ShutterReason::SUCCESS);
-            }
+            // end position reached, the motor stops by itself
+            finishTask();
         }
     }
 }
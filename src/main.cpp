@@ -1,7 +1,6 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <Arduino.h>
-#include <ArduinoLog.h>
 #include <DNSServer.h>
 #include <ESP8266WebServer.h>
 #include <ESP8266mDNS.h>
@@ -14,17 +13,39 @@
 #include "Version.h"
 #include "config.h"
 #include "Shutter.hpp"
+#include "LogBuffer.hpp"
+#include "PositionJournal.hpp"
+#include "ConfigStore.hpp"
+#include "DeadlineScheduler.hpp"
+#include "LatencyHistogram.hpp"
 
-Shutter shutter1("Left");
-Shutter shutter2("Right");
+Shutter shutters[SHUTTER_COUNT];
+DeadlineScheduler shutterScheduler;
 
 bool shouldSaveConfig = false;
-char mqttServer[40] = "";
-char mqttPort[6] = "1883";
-char mqttUser[40] = "";
-char mqttPassword[40] = "";
-char discoveryPrefix[20] = "homeassistant";
-char shutterDelay[5] = "1500";
+bool calibrationSavePending = false;
+DeviceSettings settings;
+ShutterCalibration shutterCalibration[SHUTTER_COUNT];
+
+// access point and lease of the last connection, used to connect without scanning on the next boot
+typedef struct {
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t mask;
+    uint32_t dns;
+} wifiCache_t;
+
+// milliseconds since boot until the device was connected and received its first command
+typedef struct {
+    bool fastBoot;
+    ulong wifiConnectedMillis;
+    ulong mqttConnectedMillis;
+    ulong firstCommandMillis;
+} bootStats_t;
+
+bootStats_t bootStats = {false, 0, 0, 0};
 
 WiFiEventHandler wifiConnectHandler;
 WiFiEventHandler wifiDisconnectHandler;
@@ -33,376 +54,1742 @@ String clientId;
 WiFiClient wifiClient;
 
 PubSubClient mqttClient(wifiClient);
-unsigned long mqttLastReconnectAttempt = 0;
 
-typedef struct {
-    String topic;
-    String payLoad;
-} mqttRecord_t;
+// the connection is set up in steps taken in separate loop iterations, resolving the broker blocks at most for
+// MQTT_CONNECT_TIMEOUT_MS, connecting at most twice as long for the TCP connection and the CONNACK
+enum MqttConnectionState {
+    WAIT_FOR_RECONNECT = 0,
+    RESOLVE_BROKER = 1,
+    CONNECT_BROKER = 2,
+    BROKER_CONNECTED = 3,
+};
 
-CircularBuffer<mqttRecord_t, 10> mqttQueue;
-bool suppressQueueLogMessage = false;
+MqttConnectionState mqttConnectionState = MqttConnectionState::WAIT_FOR_RECONNECT;
+IPAddress mqttBrokerIp;
+ulong mqttNextAttemptMillis = 0;
+ulong mqttReconnectDelayMs = 0;
+ulong mqttOutageStartMillis = 0;
+uint32_t mqttJitterState = 0;
 
 enum MqttMode {
     INVALID_MQTT_MODE = -100,
     GLOBAL = -1,
     DEVICE = 0,
-    SHUTTER1 = 1,
-    SHUTTER2 = 2,
+    SHUTTER = 1,
+    GROUP = 2,
+};
+
+typedef struct {
+    MqttMode mqttMode;
+    uint8_t shutterIndex;
+    ShutterAction shutterAction;
+    int position;
+    ulong sequence;
+    ulong receivedMillis;
+    char payLoad[MQTT_PAYLOAD_MAX_LENGTH + 1];
+} mqttRecord_t;
+
+// queues only hold the slot number of the record in the preallocated pool
+typedef CircularBuffer<uint8_t, MQTT_POOL_SIZE> mqttQueue_t;
+
+mqttRecord_t mqttPool[MQTT_POOL_SIZE];
+mqttQueue_t mqttPoolFreeSlots;
+ulong mqttPoolExhaustedCount = 0;
+ulong mqttEvictedCount = 0;
+ulong mqttRejectedCount = 0;
+ulong mqttSequence = 0;
+
+// control commands for the group are kept apart from announce requests, which are the first to go if the pool is full
+mqttQueue_t mqttQueueGroup;
+mqttQueue_t mqttQueueGlobal;
+mqttQueue_t mqttQueueShutter[SHUTTER_COUNT];
+bool suppressQueueLogMessageShutter[SHUTTER_COUNT] = {};
+ulong mqttCoalescedCount = 0;
+
+typedef struct {
+    ulong lastPublishMillis;
+    int lastPosition;
+    const char *lastStatus;
+} shutterProgress_t;
+
+shutterProgress_t progressShutter[SHUTTER_COUNT];
+
+// last payloads sent on a state topic, the retained one is tracked apart because progress updates are not retained,
+// the JSON state is tracked by its state and position, e.g. "closing:100", since its direction follows from the state
+typedef struct {
+    char sent[12];
+    char retained[12];
+} publishedState_t;
+
+typedef struct {
+    publishedState_t state;
+    publishedState_t position;
+    publishedState_t json;
+} publishedShutterState_t;
+
+publishedShutterState_t publishedShutter[SHUTTER_COUNT];
+publishedShutterState_t publishedGroup;
+ulong mqttSuppressedCount = 0;
+
+// shutters that still have to complete the running group move, the group status is published once all are done
+bool groupPendingShutter[SHUTTER_COUNT] = {};
+
+// one action per shutter, UNDEFINED_ACTION for shutters not addressed, all of them are planned in one step
+typedef struct {
+    bool pending;
+    ShutterAction shutterAction[SHUTTER_COUNT];
+    int position[SHUTTER_COUNT];
+    ulong receivedMillis[SHUTTER_COUNT];
+} mqttBatch_t;
+
+mqttBatch_t mqttBatch;
+
+// times of the command a shutter is working on, logged in the trace format once the shutter completed it
+typedef struct {
+    bool active;
+    ulong receivedMillis;
+    ulong dequeuedMillis;
+    ulong startMillis;
+} commandTrace_t;
+
+commandTrace_t traceShutter[SHUTTER_COUNT] = {};
+ulong traceReportedDroppedCount = 0;
+
+// the topic of the last rejected message is published from the loop, the client buffer still holds it in the callback
+bool mqttRejectPending = false;
+char mqttRejectTopic[MQTT_TOPIC_MAX_LENGTH];
+
+// histograms and high-water mark cover the current publish interval, the counters run since boot
+typedef struct {
+    LatencyHistogram loop;
+    LatencyHistogram mdns;
+    LatencyHistogram mqtt;
+    LatencyHistogram shutters;
+    LatencyHistogram queue;
+    LatencyHistogram publish;
+    LatencyHistogram log;
+    LatencyHistogram flash;
+    ulong tickMaxUs[SHUTTER_COUNT];
+    uint poolHighWater;
+    ulong busyCount;
+    ulong mqttConnectAttempts;
+    ulong mqttReconnects;
+    ulong mqttLastOutageMs;
+    ulong mqttMaxAttemptMs;
+    ulong lastPublishMillis;
+} diagnostics_t;
+
+diagnostics_t diagnostics;
+
+enum MqttCommand {
+    INVALID_MQTT_COMMAND = -1,
+    CMD = 0,
+    SET = 1,
+    SET_POSITION = 2,
+    CALIBRATE = 3,
+    BATCH = 4,
+};
+
+const char MQTT_GLOBAL_CMD_TOPIC[] = CLIENT_ID_PREFIX "s/cmd";
+
+// sub topics of a shutter or the group a command is received on
+typedef struct {
+    const char *name;
+    MqttCommand mqttCommand;
+} mqttCommandTopic_t;
+
+const mqttCommandTopic_t MQTT_COMMAND_TOPICS[] = {
+    { "set", MqttCommand::SET },
+    { "set_position", MqttCommand::SET_POSITION },
+    { "calibrate", MqttCommand::CALIBRATE },
 };
 
-Ticker onboardLedBlinker;
+// the client ID is the prefix followed by the chip ID with up to 10 digits, the prefix ends with a slash
+const size_t MQTT_DEVICE_PREFIX_MAX_LENGTH = sizeof(CLIENT_ID_PREFIX) + 11;
+
+// "shutter" followed by the shutter number or "group"
+const size_t MQTT_SCOPE_MAX_LENGTH = 12;
+const char MQTT_SHUTTER_SCOPE_PREFIX[] = "shutter";
+const size_t MQTT_SHUTTER_SCOPE_PREFIX_LENGTH = sizeof(MQTT_SHUTTER_SCOPE_PREFIX) - 1;
+
+// the scopes of the shutters are followed by the one of the group
+const uint MQTT_GROUP_SCOPE = SHUTTER_COUNT;
+
+typedef struct {
+    char name[MQTT_SCOPE_MAX_LENGTH];
+    uint8_t length;
+} mqttScope_t;
+
+// only the device prefix and the scopes are kept, a topic is "<device prefix><scope>/<sub topic>" and built into a
+// buffer on the stack when it is used, received topics are resolved to their table entry without building strings
+typedef struct {
+    char devicePrefix[MQTT_DEVICE_PREFIX_MAX_LENGTH];
+    size_t devicePrefixLength;
+    mqttScope_t scope[SHUTTER_COUNT + 1];
+} mqttTopics_t;
+
+mqttTopics_t mqttTopics;
+
+Ticker onboardLedBlinker;
+
+void blinkOnboardLed() {
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+}
+
+void startBlinkOnboardLed(bool critical = false) {
+    if (!onboardLedBlinker.active()) {
+        onboardLedBlinker.attach_ms(critical ? 200 : 800, blinkOnboardLed);
+    }
+}
+
+void stopBlinkOnboardLed() {
+    if (onboardLedBlinker.active()) {
+        onboardLedBlinker.detach();
+        digitalWrite(LED_BUILTIN, LED_ONBOARD_ACTIVE ? LOW : HIGH);
+    }
+}
+
+void setupMqttTopics() {
+    snprintf(mqttTopics.devicePrefix, sizeof(mqttTopics.devicePrefix), "%s/", clientId.c_str());
+    mqttTopics.devicePrefixLength = strlen(mqttTopics.devicePrefix);
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        snprintf(mqttTopics.scope[i].name, MQTT_SCOPE_MAX_LENGTH, "%s%d", MQTT_SHUTTER_SCOPE_PREFIX, i + 1);
+        mqttTopics.scope[i].length = strlen(mqttTopics.scope[i].name);
+    }
+
+    strlcpy(mqttTopics.scope[MQTT_GROUP_SCOPE].name, "group", MQTT_SCOPE_MAX_LENGTH);
+    mqttTopics.scope[MQTT_GROUP_SCOPE].length = strlen(mqttTopics.scope[MQTT_GROUP_SCOPE].name);
+}
+
+// topic of the device itself like its availability, "<device prefix><sub topic>"
+void buildDeviceTopic(char *topic, size_t topicSize, const char *subTopic) {
+    snprintf(topic, topicSize, "%s%s", mqttTopics.devicePrefix, subTopic);
+}
+
+// topic of a shutter or, with the group scope, of the group, "<device prefix><scope>/<sub topic>"
+void buildScopeTopic(char *topic, size_t topicSize, uint scope, const char *subTopic) {
+    snprintf(topic, topicSize, "%s%s/%s", mqttTopics.devicePrefix, mqttTopics.scope[scope].name, subTopic);
+}
+
+void buildDiscoveryTopic(char *topic, size_t topicSize, uint scope) {
+    snprintf(topic, topicSize, "%s/cover/%s%s/config", settings.discoveryPrefix, mqttTopics.devicePrefix, mqttTopics.scope[scope].name);
+}
+
+int getShutterIndex(const String &id) {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (shutters[i].getID() == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void subscribeMqttTopic(const char *topic) {
+    LOG_NOTICE("Subcribe to MQTT topic [ %s ].", topic);
+    mqttClient.subscribe(topic);
+}
+
+void publishMqttTopic(const char *topic, const char *payload, bool retain = false) {
+    LOG_NOTICE("Publish MQTT topic [ %s ] with payload [ %s ] and retain [ %s ].", topic, payload, retain ? "true" : "false");
+    mqttClient.publish(topic, payload, retain);
+}
+
+// collects the bytes written by ArduinoJson into small chunks before they are handed to the MQTT client
+class MqttPublishStream : public Print {
+
+public:
+    MqttPublishStream(PubSubClient &client) : m_client(client), m_length(0) {}
+
+    size_t write(uint8_t c) override {
+        m_buffer[m_length++] = c;
+        if (m_length == sizeof(m_buffer)) {
+            flushChunk();
+        }
+        return 1;
+    }
+
+    void flushChunk() {
+        m_client.write(m_buffer, m_length);
+        m_length = 0;
+    }
+
+private:
+    PubSubClient &m_client;
+    uint8_t m_buffer[64];
+    size_t m_length;
+
+};
+
+void publishMqttJson(const char *topic, const JsonDocument &doc, bool retain = false) {
+    size_t length = measureJson(doc);
+    MqttPublishStream stream(mqttClient);
+
+    LOG_NOTICE("Publish MQTT topic [ %s ] with JSON payload of [ %d ] bytes and retain [ %s ].", topic, length, retain ? "true" : "false");
+
+    // the payload is serialized straight into the MQTT connection, no copy of it is kept in memory
+    if (mqttClient.beginPublish(topic, length, retain)) {
+        serializeJson(doc, stream);
+        stream.flushChunk();
+        mqttClient.endPublish();
+    }
+}
+
+void resetPublishedStateMqtt() {
+    memset(publishedShutter, 0, sizeof(publishedShutter));
+    memset(&publishedGroup, 0, sizeof(publishedGroup));
+}
+
+bool isMqttStateChanged(const publishedState_t &published, const char *payload, bool retain) {
+    // a retained payload is also sent if only a progress update differed, the broker still holds the one before it
+    if (strcmp(payload, published.sent) == 0 && (!retain || strcmp(payload, published.retained) == 0)) {
+        mqttSuppressedCount++;
+        return false;
+    }
+    return true;
+}
+
+void markMqttStatePublished(publishedState_t &published, const char *payload, bool retain) {
+    strlcpy(published.sent, payload, sizeof(published.sent));
+    if (retain) {
+        strlcpy(published.retained, payload, sizeof(published.retained));
+    }
+}
+
+void publishMqttState(uint scope, const char *subTopic, publishedState_t &published, const char *payload, bool retain) {
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+
+    // the topic is only built if the state is actually sent
+    if (isMqttStateChanged(published, payload, retain)) {
+        buildScopeTopic(topic, sizeof(topic), scope, subTopic);
+        publishMqttTopic(topic, payload, retain);
+        markMqttStatePublished(published, payload, retain);
+    }
+}
+
+void sendStateJsonShutterMqtt(uint shutterIndex, const char *status, uint position, bool retain) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(3)> doc;
+    publishedState_t &published = publishedShutter[shutterIndex].json;
+    char key[sizeof(published.sent)];
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+
+    if (!MQTT_STATE_JSON) {
+        return;
+    }
+
+    snprintf(key, sizeof(key), "%s:%d", status, position);
+    if (!isMqttStateChanged(published, key, retain)) {
+        return;
+    }
+
+    doc["state"] = status;
+    doc["position"] = position;
+    doc["direction"] = strcmp(status, "opening") == 0 ? "up" : (strcmp(status, "closing") == 0 ? "down" : "none");
+    buildScopeTopic(topic, sizeof(topic), shutterIndex, "json");
+    publishMqttJson(topic, doc, retain);
+    markMqttStatePublished(published, key, retain);
+}
+
+void sendStatusShutterMqtt(uint shutterIndex) {
+    publishedShutterState_t &published = publishedShutter[shutterIndex];
+    const char *status = shutters[shutterIndex].getStatus();
+    uint position = shutters[shutterIndex].getPosition();
+    char payload[4];
+
+    snprintf(payload, sizeof(payload), "%d", position);
+    publishMqttState(shutterIndex, "state", published.state, status, true);
+    publishMqttState(shutterIndex, "position", published.position, payload, true);
+    sendStateJsonShutterMqtt(shutterIndex, status, position, true);
+}
+
+void sendStatusGroupMqtt() {
+    uint position = 0;
+    bool closed = true;
+    char payload[4];
+
+    // the group is closed once all shutters are closed, its position is the average of all shutters
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        position += shutters[i].getPosition();
+        closed = closed && shutters[i].getPosition() == 0;
+    }
+
+    publishMqttState(MQTT_GROUP_SCOPE, "state", publishedGroup.state, closed ? "closed" : "open", true);
+    snprintf(payload, sizeof(payload), "%d", position / SHUTTER_COUNT);
+    publishMqttState(MQTT_GROUP_SCOPE, "position", publishedGroup.position, payload, true);
+}
+
+void sendProgressShutterMqtt(uint shutterIndex) {
+    Shutter &shutter = shutters[shutterIndex];
+    shutterProgress_t &progress = progressShutter[shutterIndex];
+    uint position;
+    const char *status;
+    char payload[4];
+
+    if (!shutter.isMoving() || millis() - progress.lastPublishMillis < PROGRESS_PUBLISH_INTERVAL_MS) {
+        return;
+    }
+    progress.lastPublishMillis = millis();
+
+    status = shutter.getStatus();
+    if (strcmp(status, progress.lastStatus) != 0) {
+        progress.lastStatus = status;
+        publishMqttState(shutterIndex, "state", publishedShutter[shutterIndex].state, status, false);
+    }
+
+    position = shutter.getEstimatedPosition();
+    if (abs((int) position - progress.lastPosition) >= PROGRESS_PUBLISH_MIN_DELTA) {
+        progress.lastPosition = position;
+        snprintf(payload, sizeof(payload), "%d", position);
+        publishMqttState(shutterIndex, "position", publishedShutter[shutterIndex].position, payload, false);
+    }
+
+    // the JSON follows the position topic, nothing is sent before the first position of the move was published
+    if (progress.lastPosition >= 0) {
+        sendStateJsonShutterMqtt(shutterIndex, status, progress.lastPosition, false);
+    }
+}
+
+void traceMqttReceived(const char *topic, const byte *payload, unsigned int length) {
+    char tracePayload[LOG_STRING_MAX_LENGTH + 1];
+
+    if (!MQTT_TRACE) {
+        return;
+    }
+
+    length = min(length, (unsigned int) LOG_STRING_MAX_LENGTH);
+    memcpy(tracePayload, payload, length);
+    tracePayload[length] = '\0';
+    LOG_NOTICE("TRACE rx %l %s %s", millis(), topic, tracePayload);
+}
+
+void traceShutterDone(uint shutterIndex, ShutterReason reason) {
+    commandTrace_t &trace = traceShutter[shutterIndex];
+    ulong completeMillis = millis();
+
+    trace.active = false;
+
+    // all times are relative to the receipt of the command, a start of -1 means the buttons were never pressed
+    LOG_NOTICE("TRACE done %l %d wait %l start %d complete %l position %d reason %d", completeMillis, shutterIndex + 1,
+        trace.dequeuedMillis - trace.receivedMillis, trace.startMillis == 0 ? -1 : (int) (trace.startMillis - trace.receivedMillis),
+        completeMillis - trace.receivedMillis, shutters[shutterIndex].getEstimatedPosition(), reason);
+}
+
+void traceShutterCommand(uint shutterIndex, ulong receivedMillis) {
+    if (!MQTT_TRACE) {
+        return;
+    }
+
+    // the command takes over from one that was not completed yet, which ends here with its own line
+    if (traceShutter[shutterIndex].active) {
+        traceShutterDone(shutterIndex, ShutterReason::SUPERSEDED);
+    }
+    traceShutter[shutterIndex] = {true, receivedMillis, millis(), 0};
+}
+
+void traceShutterStart(uint shutterIndex) {
+    commandTrace_t &trace = traceShutter[shutterIndex];
+
+    if (trace.active && trace.startMillis == 0) {
+        trace.startMillis = millis();
+    }
+}
+
+void traceShutterComplete(uint shutterIndex, ShutterReason reason) {
+    ulong dueMillis;
+
+    // a STOP followed by the move to the target does not complete the command, a rejection always does
+    if (!traceShutter[shutterIndex].active ||
+        (reason == ShutterReason::SUCCESS && shutters[shutterIndex].getNextActionMillis(dueMillis))) {
+        return;
+    }
+
+    traceShutterDone(shutterIndex, reason);
+}
+
+void traceLogDropped() {
+    ulong droppedCount = logBuffer.getDroppedCount();
+
+    if (!MQTT_TRACE || droppedCount == traceReportedDroppedCount) {
+        return;
+    }
+
+    // the lost records might have been TRACE lines, so the trace itself tells that it is incomplete
+    LOG_NOTICE("TRACE dropped %l %l", millis(), droppedCount - traceReportedDroppedCount);
+    traceReportedDroppedCount = droppedCount;
+}
+
+bool isShutterActionDue(ulong withinMs) {
+    return shutterScheduler.getNextDueInMs(millis()) < withinMs;
+}
+
+void scheduleShutter(uint shutterIndex) {
+    ulong dueMillis;
+
+    if (shutters[shutterIndex].getNextActionMillis(dueMillis)) {
+        shutterScheduler.schedule(shutterIndex, dueMillis);
+    } else {
+        shutterScheduler.cancel(shutterIndex);
+    }
+}
+
+void workShutters() {
+    uint shutterIndex;
+    bool buttonPressed;
+    ulong tickStartMicros;
+
+    // only shutters with a due deadline are ticked, every tick moves the task on and registers its next deadline
+    while (shutterScheduler.popDue(millis(), shutterIndex)) {
+        tickStartMicros = micros();
+        buttonPressed = shutters[shutterIndex].isButtonPressed();
+        shutters[shutterIndex].tick();
+
+        // the first button pressed for a command starts it, also a STOP
+        if (!buttonPressed && shutters[shutterIndex].isButtonPressed()) {
+            traceShutterStart(shutterIndex);
+        }
+        scheduleShutter(shutterIndex);
+        diagnostics.tickMaxUs[shutterIndex] = max(diagnostics.tickMaxUs[shutterIndex], micros() - tickStartMicros);
+    }
+}
+
+void workProgress() {
+    // publishing can block on the network, so never do it shortly before a button has to be pressed or released
+    if (!mqttClient.connected() || isShutterActionDue(PROGRESS_PUBLISH_GUARD_MS)) {
+        return;
+    }
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        sendProgressShutterMqtt(i);
+    }
+}
+
+// root object with 16 members, device object with 5 members and identifier array, all strings are referenced
+const size_t DISCOVERY_JSON_CAPACITY = JSON_OBJECT_SIZE(16) + JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(1);
+
+// root object with 9 members, heap, queue (6 members), MQTT (5 members), boot and stages (8 members) objects, the longest
+// tick of every shutter and 8 histograms with an array of all buckets
+const size_t DIAGNOSTICS_JSON_CAPACITY = JSON_OBJECT_SIZE(9) + JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(8) +
+                                         JSON_ARRAY_SIZE(SHUTTER_COUNT) + 8 * (JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(LATENCY_HISTOGRAM_BUCKETS));
+
+void addHistogramJson(JsonObject parent, const char *key, LatencyHistogram &histogram) {
+    auto object = parent.createNestedObject(key);
+    auto counts = object.createNestedArray("n");
+
+    object["max"] = histogram.getMaxUs();
+    for (uint i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        counts.add(histogram.getCount(i));
+    }
+    histogram.reset();
+}
+
+void sendDiagnostics() {
+    StaticJsonDocument<DIAGNOSTICS_JSON_CAPACITY> doc;
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+
+    doc["uptime"] = millis() / 1000;
+    doc["busy"] = diagnostics.busyCount;
+    doc["log_dropped"] = logBuffer.getDroppedCount();
+
+    auto heap = doc.createNestedObject("heap");
+    heap["free"] = ESP.getFreeHeap();
+    heap["max_block"] = ESP.getMaxFreeBlockSize();
+    heap["frag"] = ESP.getHeapFragmentation();
+
+    auto queue = doc.createNestedObject("queue");
+    queue["high_water"] = diagnostics.poolHighWater;
+    queue["size"] = MQTT_POOL_SIZE;
+    queue["exhausted"] = mqttPoolExhaustedCount;
+    queue["evicted"] = mqttEvictedCount;
+    queue["rejected"] = mqttRejectedCount;
+    queue["coalesced"] = mqttCoalescedCount;
+
+    auto boot = doc.createNestedObject("boot");
+    boot["fast"] = bootStats.fastBoot;
+    boot["wifi"] = bootStats.wifiConnectedMillis;
+    boot["mqtt"] = bootStats.mqttConnectedMillis;
+    boot["first_cmd"] = bootStats.firstCommandMillis;
+
+    auto mqtt = doc.createNestedObject("mqtt");
+    mqtt["attempts"] = diagnostics.mqttConnectAttempts;
+    mqtt["reconnects"] = diagnostics.mqttReconnects;
+    mqtt["last_outage"] = diagnostics.mqttLastOutageMs;
+    mqtt["max_attempt"] = diagnostics.mqttMaxAttemptMs;
+    mqtt["suppressed"] = mqttSuppressedCount;
+
+    addHistogramJson(doc.as<JsonObject>(), "loop", diagnostics.loop);
+
+    auto stages = doc.createNestedObject("stages");
+    addHistogramJson(stages, "mdns", diagnostics.mdns);
+    addHistogramJson(stages, "mqtt", diagnostics.mqtt);
+    addHistogramJson(stages, "shutters", diagnostics.shutters);
+    addHistogramJson(stages, "queue", diagnostics.queue);
+    addHistogramJson(stages, "publish", diagnostics.publish);
+    addHistogramJson(stages, "log", diagnostics.log);
+    addHistogramJson(stages, "flash", diagnostics.flash);
+
+    auto tickMax = stages.createNestedArray("tick_max");
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        tickMax.add(diagnostics.tickMaxUs[i]);
+        diagnostics.tickMaxUs[i] = 0;
+    }
+
+    diagnostics.poolHighWater = MQTT_POOL_SIZE - mqttPoolFreeSlots.size();
+
+    buildDeviceTopic(topic, sizeof(topic), "diagnostics");
+    publishMqttJson(topic, doc);
+}
+
+void workDiagnostics() {
+    // same as for the progress, publishing must not delay a button press or release
+    if (!mqttClient.connected() || isShutterActionDue(PROGRESS_PUBLISH_GUARD_MS) ||
+        millis() - diagnostics.lastPublishMillis < DIAGNOSTICS_PUBLISH_INTERVAL_MS) {
+        return;
+    }
+    diagnostics.lastPublishMillis = millis();
+
+    sendDiagnostics();
+}
+
+// topics referenced by a discovery document, built by buildDiscoveryJson() into the buffers of the caller
+typedef struct {
+    char availability[MQTT_TOPIC_MAX_LENGTH];
+    char state[MQTT_TOPIC_MAX_LENGTH];
+    char set[MQTT_TOPIC_MAX_LENGTH];
+    char position[MQTT_TOPIC_MAX_LENGTH];
+    char setPosition[MQTT_TOPIC_MAX_LENGTH];
+} discoveryTopics_t;
+
+void buildDiscoveryJson(const char *name, const char *uniqueId, uint scope, discoveryTopics_t &topics, JsonDocument &doc) {
+    buildDeviceTopic(topics.availability, MQTT_TOPIC_MAX_LENGTH, "availability");
+    buildScopeTopic(topics.state, MQTT_TOPIC_MAX_LENGTH, scope, "state");
+    buildScopeTopic(topics.set, MQTT_TOPIC_MAX_LENGTH, scope, "set");
+    buildScopeTopic(topics.position, MQTT_TOPIC_MAX_LENGTH, scope, "position");
+    buildScopeTopic(topics.setPosition, MQTT_TOPIC_MAX_LENGTH, scope, "set_position");
+
+    // const char pointers are only referenced by the document, name, unique ID and topics have to outlive it
+    doc["name"] = name;
+    doc["uniq_id"] = uniqueId; // unique_id
+    doc["avty_t"] = (const char*) topics.availability; //availability_topic
+    doc["stat_t"] = (const char*) topics.state; //state_topic
+    doc["cmd_t"] = (const char*) topics.set; //command_topic
+    doc["pos_t"] = (const char*) topics.position; //position_topic
+    doc["set_pos_t"] = (const char*) topics.setPosition; //set_position_topic
+    doc["pl_open"] = "up"; //payload_open
+    doc["pl_cls"] = "down"; //payload_close
+    doc["pl_stop"] = "stop"; //payload_stop
+    doc["stat_open"] = "open"; //state_open
+    doc["stat_clsd"] = "closed"; //state_closed
+    doc["pl_avail"] = "online"; //payload_available
+    doc["pl_not_avail"] = "offline"; //payload_not_available
+    doc["opt"] = "true"; //optimistic
+
+    auto device = doc.createNestedObject("dev"); //device
+    auto ids = device.createNestedArray("ids"); //identifiers
+    ids.add(clientId.c_str());
+    device["mf"] = "Wemos"; //manufacturer // TODO: is there a ways to get it from the chip?
+    device["mdl"] = "D1"; //model // TODO: is there a ways to get it from the chip?
+    device["name"] = clientId.c_str();
+    device["sw"] = VERSION; //sw_version
+}
+
+void sendDiscovery() {
+    char name[32];
+    char uniqueId[48];
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+    discoveryTopics_t topics;
+
+    if (strlen(settings.discoveryPrefix) == 0) return;
+    
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        StaticJsonDocument<DISCOVERY_JSON_CAPACITY> doc;
+
+        snprintf(name, sizeof(name), "Shutter %s", shutters[i].getID().c_str());
+        snprintf(uniqueId, sizeof(uniqueId), "%s-shutter-%s", clientId.c_str(), shutters[i].getID().c_str());
+        buildDiscoveryJson(name, uniqueId, i, topics, doc);
+        buildDiscoveryTopic(topic, sizeof(topic), i);
+        publishMqttJson(topic, doc, true);
+    }
+
+    // one more cover moving all shutters of the device together
+    StaticJsonDocument<DISCOVERY_JSON_CAPACITY> doc;
+
+    snprintf(uniqueId, sizeof(uniqueId), "%s-shutter-group", clientId.c_str());
+    buildDiscoveryJson("Shutter group", uniqueId, MQTT_GROUP_SCOPE, topics, doc);
+    buildDiscoveryTopic(topic, sizeof(topic), MQTT_GROUP_SCOPE);
+    publishMqttJson(topic, doc, true);
+}
+
+void announceMqtt() {
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+
+    sendDiscovery();
+    buildDeviceTopic(topic, sizeof(topic), "availability");
+    publishMqttTopic(topic, "online", true);
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        sendStatusShutterMqtt(i);
+    }
+    sendStatusGroupMqtt();
+}
+
+bool copyPayload(char *dest, size_t destSize, const byte *payload, unsigned int length) {
+    if (length >= destSize) {
+        return false;
+    }
+
+    memcpy(dest, payload, length);
+    dest[length] = '\0';
+
+    return true;
+}
+
+int getPositionFromPayload(const char *payload) {
+    int position = 0;
+    const char *begin = payload;
+    const char *end = payload + strlen(payload);
+
+    // trim whitespace on both ends
+    while (begin < end && isspace(*begin)) {
+        begin++;
+    }
+    while (end > begin && isspace(*(end - 1))) {
+        end--;
+    }
+
+    if (begin == end) {
+        return -1;
+    }
+
+    for (const char *c = begin; c < end; c++) {
+        if (!isDigit(*c)) {
+            return -1;
+        }
+        position = position * 10 + (*c - '0');
+        if (position > 100) {
+            return -1;
+        }
+    }
+
+    return position;
+}
+
+MqttCommand getMqttCommandFromSubTopic(const char *subTopic) {
+    // the first byte leaves a single candidate, only set and set_position share it
+    switch (subTopic[0]) {
+        case 's':
+            if (strcmp(subTopic, "set") == 0) {
+                return MqttCommand::SET;
+            }
+            if (strcmp(subTopic, "set_position") == 0) {
+                return MqttCommand::SET_POSITION;
+            }
+            break;
+
+        case 'c':
+            if (strcmp(subTopic, "calibrate") == 0) {
+                return MqttCommand::CALIBRATE;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return MqttCommand::INVALID_MQTT_COMMAND;
+}
+
+bool getMqttScopeFromSubTopic(const char *subTopic, uint &scope) {
+    uint shutterNo = 0;
+
+    // the first byte tells a shutter from the group, the number of a shutter is the index of its scope in the table
+    switch (subTopic[0]) {
+        case 's':
+            if (strncmp(subTopic, MQTT_SHUTTER_SCOPE_PREFIX, MQTT_SHUTTER_SCOPE_PREFIX_LENGTH) != 0) {
+                return false;
+            }
+            for (subTopic +=MQTT_SHUTTER_SCOPE_PREFIX_LENGTH; isDigit(*subTopic) && shutterNo <= SHUTTER_COUNT; subTopic++) {
+                shutterNo = shutterNo * 10 + (*subTopic - '0');
+            }
+            if (shutterNo < 1 || shutterNo > SHUTTER_COUNT) {
+                return false;
+            }
+            scope = shutterNo - 1;
+            break;
+
+        case 'g':
+            scope = MQTT_GROUP_SCOPE;
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+bool resolveMqttTopic(const char *topic, MqttMode &mqttMode, uint8_t &shutterIndex, MqttCommand &mqttCommand) {
+    const char *subTopic;
+    uint scope;
+
+    mqttMode = MqttMode::INVALID_MQTT_MODE;
+    mqttCommand = MqttCommand::INVALID_MQTT_COMMAND;
+
+    if (strcmp(topic, MQTT_GLOBAL_CMD_TOPIC) == 0) {
+        mqttMode = MqttMode::GLOBAL;
+        mqttCommand = MqttCommand::CMD;
+        return true;
+    }
+
+    if (strncmp(topic, mqttTopics.devicePrefix, mqttTopics.devicePrefixLength) != 0) {
+        return false;
+    }
+
+    // remaining topic is "<scope>/<command>" or "batch/set"
+    subTopic = topic + mqttTopics.devicePrefixLength;
+    if (subTopic[0] == 'b') {
+        if (strcmp(subTopic, "batch/set") != 0) {
+            return false;
+        }
+        mqttMode = MqttMode::DEVICE;
+        mqttCommand = MqttCommand::BATCH;
+        return true;
+    }
+
+    if (!getMqttScopeFromSubTopic(subTopic, scope)) {
+        return false;
+    }
+
+    // only the entry picked above is compared, it also rejects what the first bytes did not, e.g. "shutter01"
+    const mqttScope_t &entry = mqttTopics.scope[scope];
+    if (strncmp(subTopic, entry.name, entry.length) != 0 || subTopic[entry.length] != '/') {
+        return false;
+    }
+
+    mqttMode = scope == MQTT_GROUP_SCOPE ? MqttMode::GROUP : MqttMode::SHUTTER;
+    shutterIndex = scope == MQTT_GROUP_SCOPE ? 0 : scope;
+    mqttCommand = getMqttCommandFromSubTopic(subTopic + entry.length + 1);
+
+    return mqttCommand != MqttCommand::INVALID_MQTT_COMMAND;
+}
+
+ShutterAction getShutterActionFromPayload(const char *payload) {
+    ShutterAction shutterAction = ShutterAction::UNDEFINED_ACTION;
+
+    if (strcasecmp(payload, "down") == 0) {
+        shutterAction = ShutterAction::DOWN;
+    } else if (strcasecmp(payload, "stop") == 0) {
+        shutterAction = ShutterAction::STOP;
+    } else if (strcasecmp(payload, "up") == 0) {
+        shutterAction = ShutterAction::UP;
+    }
+
+    return shutterAction;
+}
+
+bool parseMqttMessage(MqttCommand mqttCommand, mqttRecord_t &mqttRec) {
+    bool isValid = false;
+
+    mqttRec.shutterAction = ShutterAction::UNDEFINED_ACTION;
+    mqttRec.position = -1;
+
+    switch (mqttCommand) {
+        case MqttCommand::SET_POSITION:
+            mqttRec.position = getPositionFromPayload(mqttRec.payLoad);
+            if (mqttRec.position >= 0) {
+                mqttRec.shutterAction = ShutterAction::MOVE_BY_POSITION;
+                isValid = true;
+            }
+            break;
+
+        case MqttCommand::SET:
+            mqttRec.shutterAction = getShutterActionFromPayload(mqttRec.payLoad);
+            if (mqttRec.shutterAction != ShutterAction::UNDEFINED_ACTION) {
+                isValid = true;
+            }
+            break;
+
+        case MqttCommand::CMD:
+            if (strcmp(mqttRec.payLoad, "announce") == 0) {
+                isValid = true;
+            } else if (strcmp(mqttRec.payLoad, "stop") == 0) {
+                mqttRec.shutterAction = ShutterAction::STOP;
+                isValid = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return isValid;
+}
+
+void setupMqttPool() {
+    for (uint8_t slot = 0; slot < MQTT_POOL_SIZE; slot++) {
+        mqttPoolFreeSlots.push(slot);
+    }
+}
+
+void releaseMqttRecord(uint8_t slot) {
+    mqttPoolFreeSlots.push(slot);
+}
+
+void clearShutterQueue(uint shutterIndex) {
+    while (!mqttQueueShutter[shutterIndex].isEmpty()) {
+        mqttCoalescedCount++;
+        releaseMqttRecord(mqttQueueShutter[shutterIndex].shift());
+    }
+}
+
+bool isGroupMovePending() {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (groupPendingShutter[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isBatchButtonPressed(const mqttBatch_t &batch) {
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] != ShutterAction::UNDEFINED_ACTION && shutters[i].isButtonPressed()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void clearMqttBatch() {
+    mqttBatch.pending = false;
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        mqttBatch.shutterAction[i] = ShutterAction::UNDEFINED_ACTION;
+        mqttBatch.position[i] = -1;
+    }
+}
+
+void deferBatchEntry(const mqttBatch_t &batch, uint shutterIndex) {
+    // entries of a batch that is not pending were executed already, they must not come back with this one
+    if (!mqttBatch.pending) {
+        clearMqttBatch();
+    }
+
+    // a batch received meanwhile already holds a newer command for the shutter
+    if (mqttBatch.pending && mqttBatch.shutterAction[shutterIndex] != ShutterAction::UNDEFINED_ACTION &&
+        (long) (mqttBatch.receivedMillis[shutterIndex] - batch.receivedMillis[shutterIndex]) >= 0) {
+        return;
+    }
+
+    // taken over into the pending batch, it is planned once the button is released unless a newer command replaced it
+    mqttBatch.shutterAction[shutterIndex] = batch.shutterAction[shutterIndex];
+    mqttBatch.position[shutterIndex] = batch.position[shutterIndex];
+    mqttBatch.receivedMillis[shutterIndex] = batch.receivedMillis[shutterIndex];
+    mqttBatch.pending = true;
+
+    LOG_NOTICE("Batch action [ %d ] for shutter [ %d ] deferred, button is still pressed.", batch.shutterAction[shutterIndex], shutterIndex + 1);
+}
+
+void executeBatch(const mqttBatch_t &batch) {
+    ulong executionTimeMillis = millis();
+    bool rejected = false;
+
+    // all shutters start together once the last one is past its hold-off after the previous button press
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] != ShutterAction::UNDEFINED_ACTION && !shutters[i].isMoving() &&
+            !shutters[i].isButtonPressed() && (long) (shutters[i].getIdleMillis() - executionTimeMillis) > 0) {
+            executionTimeMillis = shutters[i].getIdleMillis();
+        }
+    }
+
+    LOG_NOTICE("Batch of shutter actions planned to start in [ %l ]ms.", executionTimeMillis - millis());
+
+    // shutters already at the target complete right away, so mark all of them before the first one is planned,
+    // shutters not part of the batch might still complete an earlier one
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] != ShutterAction::UNDEFINED_ACTION) {
+            groupPendingShutter[i] = true;
+        }
+    }
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] == ShutterAction::UNDEFINED_ACTION) {
+            continue;
+        }
+
+        // the batch is the latest command for the shutter, pending single commands are obsolete
+        clearShutterQueue(i);
+
+        // while a button is held the shutter cannot take a new task, it is known what follows once it is released
+        if (shutters[i].isButtonPressed()) {
+            deferBatchEntry(batch, i);
+            continue;
+        }
+
+        traceShutterCommand(i, batch.receivedMillis[i]);
+
+        if (!shutters[i].executeActionAt(batch.shutterAction[i], batch.position[i], executionTimeMillis)) {
+            groupPendingShutter[i] = false;
+            rejected = true;
+        }
+        scheduleShutter(i);
+
+        // the remotes must not transmit at the same time, the next button is pressed after this one is released
+        executionTimeMillis += shutterCalibration[i].pressTimeMs + GROUP_PRESS_GAP_MS;
+    }
+
+    // a rejected shutter does not complete the group move later on
+    if (rejected && !isGroupMovePending()) {
+        sendStatusGroupMqtt();
+    }
+}
+
+void executeGroupAction(ShutterAction shutterAction, int position, ulong receivedMillis) {
+    mqttBatch_t batch;
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        batch.shutterAction[i] = shutterAction;
+        batch.position[i] = position;
+        batch.receivedMillis[i] = receivedMillis;
+    }
+
+    LOG_NOTICE("Group action [ %d ] with position [ %d ].", shutterAction, position);
+    executeBatch(batch);
+}
+
+void stopShutter(uint shutterIndex, ulong stopMillis) {
+    // pending commands were sent before the STOP, they must not start the shutter again afterwards
+    clearShutterQueue(shutterIndex);
+    mqttBatch.shutterAction[shutterIndex] = ShutterAction::UNDEFINED_ACTION;
+
+    traceShutterCommand(shutterIndex, millis());
+    shutters[shutterIndex].stop(stopMillis);
+    scheduleShutter(shutterIndex);
+}
+
+void stopAllShutters() {
+    ulong stopMillis = millis();
+
+    LOG_WARNING("Stop all shutters.");
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        stopShutter(i, stopMillis);
+
+        // also in an emergency the remotes must not transmit at the same time
+        stopMillis += shutterCalibration[i].pressTimeMs + GROUP_PRESS_GAP_MS;
+    }
+}
+
+void workMqttMessage(const mqttRecord_t &mqttRec) {
+    LOG_NOTICE("MQTT message dequeued with mode [ %d ], action [ %d ], position [ %d ] and payload [ %s ].", mqttRec.mqttMode, mqttRec.shutterAction, mqttRec.position, mqttRec.payLoad);
+
+    switch (mqttRec.mqttMode) {
+        case MqttMode::SHUTTER:
+            traceShutterCommand(mqttRec.shutterIndex, mqttRec.receivedMillis);
+            shutters[mqttRec.shutterIndex].executeAction(mqttRec.shutterAction, mqttRec.position);
+            scheduleShutter(mqttRec.shutterIndex);
+            break;
+
+        case MqttMode::GROUP:
+            executeGroupAction(mqttRec.shutterAction, mqttRec.position, mqttRec.receivedMillis);
+            break;
+
+        case MqttMode::GLOBAL:
+            announceMqtt();
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool isMqttRecordSuperseded(const mqttRecord_t &pendingRec, const mqttRecord_t &newRec) {
+    // every shutter command results in an absolute target (end position, position or standstill),
+    // so a newer command for the same shutter makes any pending one obsolete, last writer wins
+    return MQTT_COALESCE_SHUTTER && pendingRec.mqttMode == newRec.mqttMode && pendingRec.shutterIndex == newRec.shutterIndex;
+}
+
+void coalesceShutterMqttMessage(mqttQueue_t &mqttQueue, const mqttRecord_t &mqttRec) {
+    uint pending = mqttQueue.size();
+
+    for (uint i = 0; i < pending; i++) {
+        uint8_t pendingSlot = mqttQueue.shift();
+        if (isMqttRecordSuperseded(mqttPool[pendingSlot], mqttRec)) {
+            mqttCoalescedCount++;
+            LOG_NOTICE("Pending MQTT message with action [ %d ] and payload [ %s ] superseded, coalesced messages [ %l ].", mqttPool[pendingSlot].shutterAction, mqttPool[pendingSlot].payLoad, mqttCoalescedCount);
+            releaseMqttRecord(pendingSlot);
+        } else {
+            mqttQueue.push(pendingSlot);
+        }
+    }
+}
+
+void workShutterQueue(Shutter &shutter, mqttQueue_t &mqttQueue, bool &suppressQueueLogMessage) {
+    uint8_t slot;
+
+    while (!mqttQueue.isEmpty()) {
+        // a moving shutter accepts new commands to adjust its move, otherwise wait until it is idle
+        if (shutter.isActionInProgress() && !shutter.isMoving()) {
+            if (!suppressQueueLogMessage) {
+                LOG_NOTICE("[ %s ] MQTT message found in queue, but shutter action is still in progress. Wait for next cycle, available queue slots [ %d ]", shutter.getID().c_str(), mqttQueue.available());
+            }
+            suppressQueueLogMessage = true;
+            break;
+        }
+        suppressQueueLogMessage = false;
+        slot = mqttQueue.shift();
+        workMqttMessage(mqttPool[slot]);
+        releaseMqttRecord(slot);
+    }
+}
+
+void workProcessQueue() {
+    mqttBatch_t batch;
+    uint8_t slot;
+
+    // global and group commands do not wait for a single shutter, process them right away, control commands first
+    while (!mqttQueueGroup.isEmpty()) {
+        slot = mqttQueueGroup.shift();
+        workMqttMessage(mqttPool[slot]);
+        releaseMqttRecord(slot);
+    }
+    while (!mqttQueueGlobal.isEmpty()) {
+        slot = mqttQueueGlobal.shift();
+        workMqttMessage(mqttPool[slot]);
+        releaseMqttRecord(slot);
+    }
+
+    // a batch waits while a button of one of its shutters is pressed, so the shutters still start together
+    // the entries are taken out of the pending batch, afterwards it only holds those deferred once more
+    if (mqttBatch.pending && !isBatchButtonPressed(mqttBatch)) {
+        batch = mqttBatch;
+        clearMqttBatch();
+        executeBatch(batch);
+    }
+
+    // each shutter drives its own remote, so only wait for the shutter the message is meant for
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        workShutterQueue(shutters[i], mqttQueueShutter[i], suppressQueueLogMessageShutter[i]);
+    }
+}
+
+bool parseMqttBatch(const byte *payload, unsigned int length, mqttBatch_t &batch) {
+    char command[MQTT_PAYLOAD_MAX_LENGTH + 1];
+    const char *c = (const char *) payload;
+    const char *end = c + length;
+    const char *commandBegin;
+    const char *commandEnd;
+    uint shutterNo;
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        batch.shutterAction[i] = ShutterAction::UNDEFINED_ACTION;
+        batch.position[i] = -1;
+    }
+
+    // entries "<shutter#>:<command>" separated by commas, the command is a position or up, down or stop
+    while (c < end) {
+        while (c < end && isspace(*c)) {
+            c++;
+        }
+
+        for (shutterNo = 0; c < end && isDigit(*c); c++) {
+            shutterNo = shutterNo * 10 + (*c - '0');
+            if (shutterNo > SHUTTER_COUNT) {
+                return false;
+            }
+        }
+        while (c < end && isspace(*c)) {
+            c++;
+        }
+        if (c == end || *c != ':' || shutterNo < 1) {
+            return false;
+        }
+
+        commandBegin = ++c;
+        while (c < end && *c != ',') {
+            c++;
+        }
+        commandEnd = c;
+        if (c < end) {
+            c++;
+        }
 
-void blinkOnboardLed() {
-    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-}
+        // trim whitespace on both ends, the command is copied to terminate it without touching the client buffer
+        while (commandBegin < commandEnd && isspace(*commandBegin)) {
+            commandBegin++;
+        }
+        while (commandEnd > commandBegin && isspace(*(commandEnd - 1))) {
+            commandEnd--;
+        }
+        if (!copyPayload(command, sizeof(command), (const byte *) commandBegin, commandEnd - commandBegin)) {
+            return false;
+        }
 
-void startBlinkOnboardLed(bool critical = false) {
-    if (!onboardLedBlinker.active()) {
-        onboardLedBlinker.attach_ms(critical ? 200 : 800, blinkOnboardLed);
-    }
-}
+        ShutterAction &shutterAction = batch.shutterAction[shutterNo - 1];
+        int &position = batch.position[shutterNo - 1];
 
-void stopBlinkOnboardLed() {
-    if (onboardLedBlinker.active()) {
-        onboardLedBlinker.detach();
-        digitalWrite(LED_BUILTIN, LED_ONBOARD_ACTIVE ? LOW : HIGH);
+        position = getPositionFromPayload(command);
+        if (position >= 0) {
+            shutterAction = ShutterAction::MOVE_BY_POSITION;
+        } else {
+            shutterAction = getShutterActionFromPayload(command);
+            if (shutterAction == ShutterAction::UNDEFINED_ACTION) {
+                return false;
+            }
+        }
     }
-}
 
-void printTimestamp(Print* _logOutput) {
-    char c[12];
-    sprintf(c, "%10lu ", millis());
-    _logOutput->print(c);
+    return length > 0;
 }
 
-void printNewline(Print* _logOutput) {
-    _logOutput->print('\n');
-}
+void receiveMqttBatch(const byte *payload, unsigned int length) {
+    mqttBatch_t batch;
+    ulong stopMillis = millis();
+    bool planned = false;
 
-String buildMqttTopic (String subTopic, MqttMode mqttMode) {
-    String mqttTopic;
-    
-    if (mqttMode == MqttMode::GLOBAL) {
-        mqttTopic = String(CLIENT_ID_PREFIX) + "s/";
-    } else {
-        mqttTopic = clientId + "/";
+    // the batch is only taken over as a whole, a single invalid entry rejects all of them
+    if (!parseMqttBatch(payload, length, batch)) {
+        LOG_WARNING("MQTT batch with length [ %d ] cannot be processed, invalid entry found.", length);
+        return;
     }
 
-    if (mqttMode > MqttMode::DEVICE) {
-        mqttTopic += "shutter" + String(mqttMode) + "/";    
+    // STOP entries do not wait for the others to start, they are applied right away like a single STOP
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] == ShutterAction::STOP) {
+            batch.shutterAction[i] = ShutterAction::UNDEFINED_ACTION;
+            stopShutter(i, stopMillis);
+            stopMillis += shutterCalibration[i].pressTimeMs + GROUP_PRESS_GAP_MS;
+        } else if (batch.shutterAction[i] != ShutterAction::UNDEFINED_ACTION) {
+            planned = true;
+        }
     }
-    mqttTopic += subTopic;
 
-    return mqttTopic;
-}
+    if (!planned) {
+        LOG_NOTICE("MQTT batch with length [ %d ] arrived, STOP applied right away.", length);
+        return;
+    }
 
-void subscribeMqttTopic(String topic) {
-    Log.notice("[ %s:%d ] Subcribe to MQTT topic [ %s ].", __FILE__, __LINE__, topic.c_str());
-    mqttClient.subscribe(topic.c_str());
-}
+    // entries of a batch still pending are kept unless this batch addresses the same shutter, those of one that is
+    // not pending were executed already
+    if (!mqttBatch.pending) {
+        clearMqttBatch();
+    }
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (batch.shutterAction[i] != ShutterAction::UNDEFINED_ACTION) {
+            mqttBatch.shutterAction[i] = batch.shutterAction[i];
+            mqttBatch.position[i] = batch.position[i];
+            mqttBatch.receivedMillis[i] = millis();
+        }
+    }
+    mqttBatch.pending = true;
 
-void publishMqttTopic(String topic, String payload, bool retain = false) {
-    Log.notice("[ %s:%d ] Publish MQTT topic [ %s ] with payload [ %s ] and retain [ %s ].", __FILE__, __LINE__, topic.c_str(), payload.c_str(), retain ? "true" : "false");
-    mqttClient.publish(topic.c_str(), payload.c_str(), retain);
+    LOG_NOTICE("MQTT batch with length [ %d ] arrived and planned for the next cycle.", length);
 }
 
-void sendStatusShutter1Mqtt() {
-    publishMqttTopic(buildMqttTopic("state", MqttMode::SHUTTER1), shutter1.getStatus(), true);
-    publishMqttTopic(buildMqttTopic("position", MqttMode::SHUTTER1), String(shutter1.getPosition()), true);
-}
+void applyShutterCalibration(uint shutterIndex) {
+    const ShutterCalibration &calibration = shutterCalibration[shutterIndex];
 
-void sendStatusShutter2Mqtt() {
-    publishMqttTopic(buildMqttTopic("state", MqttMode::SHUTTER2), shutter2.getStatus(), true);
-    publishMqttTopic(buildMqttTopic("position", MqttMode::SHUTTER2), String(shutter2.getPosition()), true);
+    shutters[shutterIndex].setDurationFullMoveMs(calibration.durationUpMs, calibration.durationDownMs);
+    shutters[shutterIndex].setMotorLatencyMs(calibration.startLatencyMs, calibration.stopLatencyMs);
+    shutters[shutterIndex].setPressTimeMs(calibration.pressTimeMs);
 }
 
-String buildDiscoveryJson(Shutter &shutter) {
-    MqttMode mqttMode = (shutter.getID() == shutter1.getID() ? MqttMode::SHUTTER1 : MqttMode::SHUTTER2);
-    DynamicJsonDocument doc(1024);
-    char payload[1024];
+bool parseShutterCalibration(const byte *payload, unsigned int length, ShutterCalibration &calibration) {
+    const char *c = (const char *) payload;
+    const char *end = c + length;
+    ulong values[5];
+    uint count = 0;
 
-    doc["name"] = "Shutter " + shutter.getID();
-    doc["uniq_id"] = clientId + "-shutter-" + shutter.getID(); // unique_id
-    doc["avty_t"] = buildMqttTopic("availability", MqttMode::DEVICE); //availability_topic
-    doc["stat_t"] = buildMqttTopic("state", mqttMode); //state_topic
-    doc["cmd_t"] = buildMqttTopic("set", mqttMode); //command_topic
-    doc["pos_t"] = buildMqttTopic("position", mqttMode); //position_topic
-    doc["set_pos_t"] = buildMqttTopic("set_position", mqttMode); //set_position_topic
-    doc["pl_open"] = "up"; //payload_open
-    doc["pl_cls"] = "down"; //payload_close
-    doc["pl_stop"] = "stop"; //payload_stop
-    doc["stat_open"] = "open"; //state_open
-    doc["stat_clsd"] = "closed"; //state_closed
-    doc["pl_avail"] = "online"; //payload_available
-    doc["pl_not_avail"] = "offline"; //payload_not_available
-    doc["opt"] = "true"; //optimistic
+    // "<up>,<down>,<press>,<start latency>,<stop latency>" in ms, parsed straight from the client buffer
+    while (count < 5) {
+        while (c < end && isspace(*c)) {
+            c++;
+        }
+        if (c == end || !isDigit(*c)) {
+            return false;
+        }
+        for (values[count] = 0; c < end && isDigit(*c); c++) {
+            values[count] = values[count] * 10 + (*c - '0');
+            if (values[count] > UINT16_MAX * 10UL) {
+                return false;
+            }
+        }
+        while (c < end && isspace(*c)) {
+            c++;
+        }
+        count++;
 
-    auto device = doc.createNestedObject("dev"); //device
-    auto ids = device.createNestedArray("ids"); //identifiers
-    ids.add(clientId);
-    device["mf"] = "Wemos"; //manufacturer // TODO: is there a ways to get it from the chip?
-    device["mdl"] = "D1"; //model // TODO: is there a ways to get it from the chip?
-    device["name"] = clientId;
-    device["sw"] = VERSION; //sw_version
+        if (c < end && *c == ',' && count < 5) {
+            c++;
+        } else if (c != end) {
+            return false;
+        }
+    }
+
+    if (values[0] == 0 || values[1] == 0 || values[2] == 0 || values[2] > UINT16_MAX || values[3] > UINT16_MAX || values[4] > UINT16_MAX) {
+        return false;
+    }
 
-    serializeJson(doc, payload, sizeof(payload));
+    calibration.durationUpMs = values[0];
+    calibration.durationDownMs = values[1];
+    calibration.pressTimeMs = values[2];
+    calibration.startLatencyMs = values[3];
+    calibration.stopLatencyMs = values[4];
 
-    return String(payload);
+    return true;
 }
 
-void sendDiscovery() {
-    if (discoveryPrefix == NULL || strlen(discoveryPrefix) <= 0) return;
-    
-    String topic;
-    String payload;
+void receiveShutterCalibration(uint8_t shutterIndex, const byte *payload, unsigned int length) {
+    ShutterCalibration calibration = shutterCalibration[shutterIndex];
+
+    if (!parseShutterCalibration(payload, length, calibration)) {
+        LOG_WARNING("MQTT calibration with length [ %d ] for shutter [ %d ] cannot be processed, invalid value found.", length, shutterIndex + 1);
+        return;
+    }
 
-    topic = String(discoveryPrefix) + "/" + "cover" + "/" + clientId + "/shutter1/config";
-    payload = buildDiscoveryJson(shutter1);
-    publishMqttTopic(topic, payload, true);
+    // durations of a running action are not changed halfway, the position would be calculated with both of them
+    if (shutters[shutterIndex].isActionInProgress()) {
+        LOG_WARNING("MQTT calibration for shutter [ %d ] rejected, shutter is busy.", shutterIndex + 1);
+        return;
+    }
+
+    // writing the flash blocks for a while, it is saved from the loop once no shutter needs attention
+    shutterCalibration[shutterIndex] = calibration;
+    applyShutterCalibration(shutterIndex);
+    calibrationSavePending = true;
 
-    topic = String(discoveryPrefix) + "/" + "cover" + "/" + clientId + "/shutter2/config";
-    payload = buildDiscoveryJson(shutter2);
-    publishMqttTopic(topic, payload, true);
+    LOG_NOTICE("Calibration of shutter [ %d ] set to up [ %l ]ms, down [ %l ]ms, press [ %d ]ms, latency [ %d / %d ]ms.", shutterIndex + 1,
+        calibration.durationUpMs, calibration.durationDownMs, calibration.pressTimeMs, calibration.startLatencyMs, calibration.stopLatencyMs);
 }
 
-void announceMqtt() {
-    sendDiscovery();
-    publishMqttTopic(buildMqttTopic("availability", MqttMode::DEVICE), "online", true);
-    sendStatusShutter1Mqtt();
-    sendStatusShutter2Mqtt();
+void evictMqttRecord(mqttQueue_t &mqttQueue) {
+    uint8_t slot = mqttQueue.shift();
+
+    mqttEvictedCount++;
+    LOG_WARNING("MQTT message with mode [ %d ] and payload [ %s ] evicted from full pool, count [ %l ].", mqttPool[slot].mqttMode, mqttPool[slot].payLoad, mqttEvictedCount);
+    releaseMqttRecord(slot);
 }
 
-String convertPayload(byte* payload, unsigned int length) {
-    String strPayload = "";
+mqttQueue_t *getOldestControlMqttQueue() {
+    mqttQueue_t *oldestQueue = mqttQueueGroup.isEmpty() ? NULL : &mqttQueueGroup;
 
-    for (uint i = 0; i < length; i++) {
-        strPayload += (char)payload[i];
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (!mqttQueueShutter[i].isEmpty() && (oldestQueue == NULL ||
+            (long) (mqttPool[mqttQueueShutter[i].first()].sequence - mqttPool[oldestQueue->first()].sequence) < 0)) {
+            oldestQueue = &mqttQueueShutter[i];
+        }
     }
-
-    return strPayload;
+    return oldestQueue;
 }
 
-int getPositionFromPayload(String payload) {
-    int position = -1;
-    bool isNum = true;
+bool makeRoomMqttPool(const mqttRecord_t &mqttRec) {
+    mqttQueue_t *oldestQueue;
 
-    payload.trim();
-    for(byte i = 0; i < payload.length(); i++) {
-        isNum = isDigit(payload.charAt(i));
-        if (!isNum) {
-            break;
-        }
+    mqttPoolExhaustedCount++;
+
+    // announce requests are the lowest priority lane, they never push out a control command
+    if (mqttRec.mqttMode != MqttMode::GLOBAL && !mqttQueueGlobal.isEmpty()) {
+        evictMqttRecord(mqttQueueGlobal);
+        return true;
+    }
+
+    // the received command leads to an absolute target, so it replaces what is still pending for its shutter
+    if (MQTT_OVERFLOW_POLICY == MQTT_OVERFLOW_COALESCE_SHUTTER && mqttRec.mqttMode == MqttMode::SHUTTER &&
+        !mqttQueueShutter[mqttRec.shutterIndex].isEmpty()) {
+        clearShutterQueue(mqttRec.shutterIndex);
+        return true;
     }
 
-    if (isNum) {
-        position = payload.toInt();
-        if (position < 0 || position > 100) {
-            position = -1;
+    if (MQTT_OVERFLOW_POLICY == MQTT_OVERFLOW_DROP_OLDEST) {
+        oldestQueue = mqttRec.mqttMode == MqttMode::GLOBAL ? &mqttQueueGlobal : getOldestControlMqttQueue();
+        if (oldestQueue != NULL && !oldestQueue->isEmpty()) {
+            evictMqttRecord(*oldestQueue);
+            return true;
         }
     }
 
-    return position;
+    return false;
 }
 
-MqttMode getMqttModeFromTopic(String topic) {
-    MqttMode mqttMode = MqttMode::INVALID_MQTT_MODE;
-    
-    if (topic.startsWith(buildMqttTopic("", MqttMode::SHUTTER1))) {
-        mqttMode = MqttMode::SHUTTER1;
-    } else if (topic.startsWith(buildMqttTopic("", MqttMode::SHUTTER2))) {
-        mqttMode = MqttMode::SHUTTER2;
-    } else if (topic.startsWith(buildMqttTopic("", MqttMode::DEVICE))) {
-        mqttMode = MqttMode::DEVICE;
-    } else if (topic.startsWith(buildMqttTopic("", MqttMode::GLOBAL))) {
-        mqttMode = MqttMode::GLOBAL;
-    } 
+void rejectMqttMessage(const char *topic) {
+    mqttRejectedCount++;
+    LOG_WARNING("No free MQTT message slot available, message with topic [ %s ] discarded, count [ %l ].", topic, mqttRejectedCount);
 
-    return mqttMode;
+    if (MQTT_REJECT_NOTIFY) {
+        strncpy(mqttRejectTopic, topic, sizeof(mqttRejectTopic) - 1);
+        mqttRejectTopic[sizeof(mqttRejectTopic) - 1] = '\0';
+        mqttRejectPending = true;
+    }
 }
 
-ShutterAction getShutterActionFromPayload(String payload) {
-    ShutterAction shutterAction = ShutterAction::UNDEFINED_ACTION;
+void workRejectNotification() {
+    char topic[MQTT_TOPIC_MAX_LENGTH];
 
-    if (payload.equalsIgnoreCase("down")) {
-        shutterAction = ShutterAction::DOWN;
-    } else if (payload.equalsIgnoreCase("stop")) {
-        shutterAction = ShutterAction::STOP;
-    } else if (payload.equalsIgnoreCase("up")) {
-        shutterAction = ShutterAction::UP;
+    if (!mqttRejectPending || !mqttClient.connected() || isShutterActionDue(PROGRESS_PUBLISH_GUARD_MS)) {
+        return;
     }
+    mqttRejectPending = false;
 
-    return shutterAction;
+    buildDeviceTopic(topic, sizeof(topic), "rejected");
+    publishMqttTopic(topic, mqttRejectTopic);
 }
 
-void workMqttMessage(mqttRecord_t mqttRec) {
-    MqttMode mqttMode = getMqttModeFromTopic(mqttRec.topic);
-    bool isValid = false;
-    int position = -1;
-    ShutterAction shutterAction = ShutterAction::UNDEFINED_ACTION;
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    mqttRecord_t mqttRec;
+    MqttCommand mqttCommand;
+    bool resolved;
+    uint8_t slot;
 
-    Log.notice("[ %s:%d ] MQTT message dequeued with topic [ %s ] and payload [ %s ].", __FILE__, __LINE__, mqttRec.topic.c_str(), mqttRec.payLoad.c_str());
+    if (bootStats.firstCommandMillis == 0) {
+        bootStats.firstCommandMillis = millis();
+    }
+    traceMqttReceived(topic, payload, length);
+    resolved = resolveMqttTopic(topic, mqttRec.mqttMode, mqttRec.shutterIndex, mqttCommand);
 
-    if (mqttMode != MqttMode::INVALID_MQTT_MODE) {
-        if (mqttMode == MqttMode::SHUTTER1 ||
-            mqttMode == MqttMode::SHUTTER2) {
-            if (mqttRec.topic.endsWith("set_position")) {
-                position = getPositionFromPayload(mqttRec.payLoad);
-                if (position >= 0) {
-                    shutterAction = ShutterAction::MOVE_BY_POSITION;
-                    isValid = true;
-                }
-            } else if (mqttRec.topic.endsWith("set")) {
-                shutterAction = getShutterActionFromPayload(mqttRec.payLoad);
-                if (shutterAction != ShutterAction::UNDEFINED_ACTION) {
-                    isValid = true;
-                }
-            }
+    // a batch does not fit into a pooled record, it is parsed straight from the client buffer
+    if (resolved && mqttCommand == MqttCommand::BATCH) {
+        receiveMqttBatch(payload, length);
+        return;
+    }
 
-            if (isValid) {
-                if (mqttMode == MqttMode::SHUTTER1) {
-                    shutter1.executeAction(shutterAction, position);
-                } else if (mqttMode == MqttMode::SHUTTER2) {
-                    shutter2.executeAction(shutterAction, position);
-                }                
-            }
-        } else if (mqttMode == MqttMode::GLOBAL) {
-            if (mqttRec.payLoad == "announce") {
-                isValid = true;
-                announceMqtt();
-             }
+    // a calibration does not fit into a pooled record either, it is applied right away and saved from the loop
+    if (resolved && mqttCommand == MqttCommand::CALIBRATE) {
+        if (mqttRec.mqttMode == MqttMode::SHUTTER) {
+            receiveShutterCalibration(mqttRec.shutterIndex, payload, length);
         }
+        return;
     }
 
-    if (!isValid) {
-        Log.warning("[ %s:%d ] MQTT message cannot be processed, most likly incorrect topic [ %s ] or payload [ %s ].", __FILE__, __LINE__, mqttRec.topic.c_str(), mqttRec.payLoad.c_str());
+    // parse on the stack, only messages that are queued take a slot of the pool, nothing is allocated on the heap
+    if (!resolved || !copyPayload(mqttRec.payLoad, sizeof(mqttRec.payLoad), payload, length) ||
+        !parseMqttMessage(mqttCommand, mqttRec)) {
+        LOG_WARNING("MQTT message cannot be processed, most likly incorrect topic [ %s ] or payload with length [ %d ].", topic, length);
+        return;
     }
-}
 
-void workProcessQueue() {
-    mqttRecord_t mqttRec;
-    
-    while (!mqttQueue.isEmpty()) {
-        if (shutter1.isActionInProgress() || shutter2.isActionInProgress()) {
-            if (!suppressQueueLogMessage) {
-                Log.notice("[ %s:%d ] MQTT message found in queue, but shutter action is still in progress. Wait for next cycle, available queue slots [ %d ]", __FILE__, __LINE__, mqttQueue.available());
-            }
-            suppressQueueLogMessage = true;
-            break;
+    // STOP neither waits behind other commands nor for a busy shutter, it is applied right away and the button
+    // is pressed by the shutter work following the MQTT client in the same loop iteration
+    if (mqttRec.shutterAction == ShutterAction::STOP) {
+        LOG_NOTICE("MQTT message arrived with topic [ %s ] and payload [ %s ], STOP applied right away.", topic, mqttRec.payLoad);
+        if (mqttRec.mqttMode == MqttMode::SHUTTER) {
+            stopShutter(mqttRec.shutterIndex, millis());
+        } else {
+            stopAllShutters();
         }
-        suppressQueueLogMessage = false;
-        workMqttMessage(mqttQueue.shift());
+        return;
     }
-}
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    String strPayLoad = convertPayload(payload, length);
+    // a command replacing a pending one for its shutter takes over the slot of it, even if all slots are in use
+    if (mqttRec.mqttMode == MqttMode::SHUTTER) {
+        coalesceShutterMqttMessage(mqttQueueShutter[mqttRec.shutterIndex], mqttRec);
+    }
+
+    if (mqttPoolFreeSlots.isEmpty() && !makeRoomMqttPool(mqttRec)) {
+        rejectMqttMessage(topic);
+        return;
+    }
+
+    slot = mqttPoolFreeSlots.shift();
+    diagnostics.poolHighWater = max(diagnostics.poolHighWater, (uint) (MQTT_POOL_SIZE - mqttPoolFreeSlots.size()));
+    mqttRec.sequence = mqttSequence++;
+    mqttRec.receivedMillis = millis();
+    mqttPool[slot] = mqttRec;
+
+    switch (mqttRec.mqttMode) {
+        case MqttMode::SHUTTER:
+            // a newer single command for the shutter wins over its entry in a pending batch
+            mqttBatch.shutterAction[mqttRec.shutterIndex] = ShutterAction::UNDEFINED_ACTION;
+            mqttQueueShutter[mqttRec.shutterIndex].push(slot);
+            break;
 
-    Log.notice("[ %s:%d ] MQTT message arrived and enqueued with topic [ %s ] and payload [ %s ].", __FILE__, __LINE__, topic, strPayLoad.c_str());
-    mqttQueue.push(mqttRecord_t{String(topic), strPayLoad});
+        case MqttMode::GROUP:
+            mqttQueueGroup.push(slot);
+            break;
+
+        default:
+            mqttQueueGlobal.push(slot);
+            break;
+    }
+
+    LOG_NOTICE("MQTT message arrived and enqueued with topic [ %s ] and payload [ %s ].", topic, mqttRec.payLoad);
 }
 
 bool connectToMqtt() {
     bool connected;
+    char topic[MQTT_TOPIC_MAX_LENGTH];
 
     char *user = NULL;
     char *pwd = NULL;
 
-    if (strlen(mqttUser) > 0) {
-        user = mqttUser;
+    if (strlen(settings.mqttUser) > 0) {
+        user = settings.mqttUser;
     }
-    if (strlen(mqttPassword) > 0) {
-        pwd = mqttPassword;
+    if (strlen(settings.mqttPassword) > 0) {
+        pwd = settings.mqttPassword;
     }
 
-    Log.notice("[ %s:%d ] Connecting to MQTT broker [ %s:%s ] with client ID [ %s ].", __FILE__, __LINE__, mqttServer, mqttPort, clientId.c_str());
+    LOG_NOTICE("Connecting to MQTT broker [ %s:%s ] with client ID [ %s ].", settings.mqttServer, settings.mqttPort, clientId.c_str());
    
-    connected = mqttClient.connect(clientId.c_str(), user, pwd, buildMqttTopic("availability", MqttMode::DEVICE).c_str(), 0, true, "offline", true);
+    buildDeviceTopic(topic, sizeof(topic), "availability");
+    connected = mqttClient.connect(clientId.c_str(), user, pwd, topic, 0, true, "offline", true);
 
     if (connected) {
-        Log.notice("[ %s:%d ] Successfully connected to MQTT broker [ %s:%d ]", __FILE__, __LINE__, mqttServer, mqttPort);
-
-        subscribeMqttTopic(buildMqttTopic("cmd", MqttMode::GLOBAL));
+        LOG_NOTICE("Successfully connected to MQTT broker [ %s:%d ]", settings.mqttServer, settings.mqttPort);
 
-        subscribeMqttTopic(buildMqttTopic("set", MqttMode::SHUTTER1));
-        subscribeMqttTopic(buildMqttTopic("set_position", MqttMode::SHUTTER1));
-
-        subscribeMqttTopic(buildMqttTopic("set", MqttMode::SHUTTER2));
-        subscribeMqttTopic(buildMqttTopic("set_position", MqttMode::SHUTTER2));
+        subscribeMqttTopic(MQTT_GLOBAL_CMD_TOPIC);
 
+        for (uint i = 0; i < SHUTTER_COUNT; i++) {
+            for (const mqttCommandTopic_t &commandTopic : MQTT_COMMAND_TOPICS) {
+                buildScopeTopic(topic, sizeof(topic), i, commandTopic.name);
+                subscribeMqttTopic(topic);
+            }
+        }
+        buildDeviceTopic(topic, sizeof(topic), "batch/set");
+        subscribeMqttTopic(topic);
+        buildScopeTopic(topic, sizeof(topic), MQTT_GROUP_SCOPE, "set");
+        subscribeMqttTopic(topic);
+        buildScopeTopic(topic, sizeof(topic), MQTT_GROUP_SCOPE, "set_position");
+        subscribeMqttTopic(topic);
+
+        // the broker might have lost the retained states while the connection was down, so all of them are sent again
+        resetPublishedStateMqtt();
         announceMqtt();
     } else {
-        Log.error("[ %s:%d ] Failed connection to MQTT broker [ %s:%s ] with status [ %d ].", __FILE__, __LINE__, mqttServer, mqttPort, mqttClient.state());
+        LOG_ERROR("Failed connection to MQTT broker [ %s:%s ] with status [ %d ].", settings.mqttServer, settings.mqttPort, mqttClient.state());
     }
 
     return connected;
 }
 
+void workLog() {
+    // printing to serial takes milliseconds per line, only do it if no shutter needs attention soon
+    if (logBuffer.isEmpty() || isShutterActionDue(LOG_DRAIN_GUARD_MS)) {
+        return;
+    }
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (!mqttQueueShutter[i].isEmpty() && !shutters[i].isActionInProgress()) {
+            return;
+        }
+    }
+
+    logBuffer.drain(LOG_DRAIN_MAX_RECORDS);
+    traceLogDropped();
+}
+
+void workJournal() {
+    if (!positionJournal.isFlushPending() || isShutterActionDue(POSITION_JOURNAL_GUARD_MS)) {
+        return;
+    }
+
+    positionJournal.flush();
+}
+
+void workConfigSave() {
+    if (!calibrationSavePending || isShutterActionDue(CONFIG_SAVE_GUARD_MS)) {
+        return;
+    }
+    calibrationSavePending = false;
+
+    configStore.save(settings, shutterCalibration);
+}
+
+void idleUntilNextDeadline() {
+    ulong idleMs;
+
+    // pending work is done on the next iteration, never idle while there is some
+    if (!logBuffer.isEmpty() || !mqttQueueGroup.isEmpty() || !mqttQueueGlobal.isEmpty() || mqttRejectPending) {
+        return;
+    }
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        if (!mqttQueueShutter[i].isEmpty()) {
+            return;
+        }
+    }
+
+    // delay() hands the time to the WiFi stack, it is capped so incoming MQTT messages are not held back
+    idleMs = min(shutterScheduler.getNextDueInMs(millis()), (ulong) LOOP_IDLE_MAX_MS);
+    if (idleMs > 0) {
+        delay(idleMs);
+    }
+}
+
 void setupMqtt() {
-    mqttClient.setBufferSize(1024);
-    mqttClient.setServer(mqttServer, String(mqttPort).toInt());
+    setupMqttTopics();
+    setupMqttPool();
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
     mqttClient.setCallback(mqttCallback);
+    mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT_MS / 1000);
+    wifiClient.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+}
+
+ulong getMqttReconnectJitterMs(ulong delayMs) {
+    // xorshift seeded with the chip ID, so devices restarted together spread their attempts differently
+    if (mqttJitterState == 0) {
+        mqttJitterState = ESP.getChipId() | 1;
+    }
+    mqttJitterState ^= mqttJitterState << 13;
+    mqttJitterState ^= mqttJitterState >> 17;
+    mqttJitterState ^= mqttJitterState << 5;
+
+    return mqttJitterState % (delayMs / 4 + 1);
+}
+
+void scheduleMqttReconnect() {
+    // exponential backoff, doubled after every failed attempt up to the maximum
+    mqttReconnectDelayMs = mqttReconnectDelayMs == 0 ? MQTT_RECONNECT_MIN_MS : min(mqttReconnectDelayMs * 2, (ulong) MQTT_RECONNECT_MAX_MS);
+    mqttNextAttemptMillis = millis() + mqttReconnectDelayMs + getMqttReconnectJitterMs(mqttReconnectDelayMs);
+    mqttConnectionState = MqttConnectionState::WAIT_FOR_RECONNECT;
+
+    LOG_NOTICE("Next connection attempt to MQTT broker in [ %l ]ms.", mqttNextAttemptMillis - millis());
+}
+
+bool resolveMqttBroker() {
+    // an IP address is taken as is, a host name is looked up before every attempt to follow a moved broker
+    if (!mqttBrokerIp.fromString(settings.mqttServer) && !WiFi.hostByName(settings.mqttServer, mqttBrokerIp, MQTT_CONNECT_TIMEOUT_MS)) {
+        LOG_ERROR("Failed to resolve MQTT broker [ %s ].", settings.mqttServer);
+        return false;
+    }
+
+    mqttClient.setServer(mqttBrokerIp, atoi(settings.mqttPort));
+    return true;
 }
 
 bool checkMqttConnection() {
-    bool isConnected = false;
-    
-    if (WiFi.isConnected()) {
-        if (mqttClient.connected()) {
-            stopBlinkOnboardLed();        
-            mqttClient.loop();
-            isConnected = true;
-        } else {
+    ulong attemptStartMillis;
+
+    if (!WiFi.isConnected()) {
+        return false;
+    }
+
+    switch (mqttConnectionState) {
+        case MqttConnectionState::BROKER_CONNECTED:
+            if (mqttClient.connected()) {
+                stopBlinkOnboardLed();
+                mqttClient.loop();
+                return true;
+            }
+
+            LOG_WARNING("Lost connection to MQTT broker with status [ %d ].", mqttClient.state());
             startBlinkOnboardLed();
-            ulong now = millis();
-            if (now - mqttLastReconnectAttempt > 5000) {
-                mqttLastReconnectAttempt = now;
-                if (connectToMqtt()) {
-                    mqttLastReconnectAttempt = 0;
+            mqttOutageStartMillis = millis();
+            mqttReconnectDelayMs = 0;
+            scheduleMqttReconnect();
+            break;
+
+        case MqttConnectionState::WAIT_FOR_RECONNECT:
+            if ((long) (millis() - mqttNextAttemptMillis) >= 0) {
+                startBlinkOnboardLed();
+                mqttConnectionState = MqttConnectionState::RESOLVE_BROKER;
+            }
+            break;
+
+        case MqttConnectionState::RESOLVE_BROKER:
+        case MqttConnectionState::CONNECT_BROKER:
+            // every step blocks the loop, so only take it if no shutter needs attention meanwhile
+            if (isShutterActionDue(MQTT_CONNECT_GUARD_MS)) {
+                break;
+            }
+
+            if (mqttConnectionState == MqttConnectionState::RESOLVE_BROKER) {
+                if (resolveMqttBroker()) {
+                    mqttConnectionState = MqttConnectionState::CONNECT_BROKER;
+                } else {
+                    scheduleMqttReconnect();
                 }
+                break;
             }
-        }
+
+            attemptStartMillis = millis();
+            diagnostics.mqttConnectAttempts++;
+            if (connectToMqtt()) {
+                mqttConnectionState = MqttConnectionState::BROKER_CONNECTED;
+                if (bootStats.mqttConnectedMillis == 0) {
+                    bootStats.mqttConnectedMillis = millis();
+                }
+                mqttReconnectDelayMs = 0;
+                diagnostics.mqttReconnects++;
+                diagnostics.mqttLastOutageMs = millis() - mqttOutageStartMillis;
+            } else {
+                scheduleMqttReconnect();
+            }
+            diagnostics.mqttMaxAttemptMs = max(diagnostics.mqttMaxAttemptMs, millis() - attemptStartMillis);
+            break;
     }
 
-    return isConnected;
+    return mqttConnectionState == MqttConnectionState::BROKER_CONNECTED;
 }
 
-void shutterActionInProgress(String id, ShutterAction shutterAction) {
+void shutterActionInProgress(const String &id, ShutterAction shutterAction) {
+    int shutterIndex = getShutterIndex(id);
+
+    // start reporting progress of the new move from scratch
+    if (shutterIndex >= 0) {
+        progressShutter[shutterIndex] = {0, -1, ""};
 
+        // remember the move, if it is cut off by a power loss the shutter runs into its end position,
+        // the button is pressed right after this callback, so the journal is only written by the loop
+        if (shutterAction == ShutterAction::UP || shutterAction == ShutterAction::DOWN) {
+            positionJournal.recordMove(shutterIndex, shutters[shutterIndex].getPosition(), shutterAction);
+        }
+    }
 }
 
-void shutterActionComplete(String id, ShutterAction shutterAction, ShutterReason reason) {
-    if (shutter1.getID() = id) {
-        sendStatusShutter1Mqtt();
-    } else {
-        sendStatusShutter2Mqtt();
+void shutterActionComplete(const String &id, ShutterAction, ShutterReason reason) {
+    int shutterIndex = getShutterIndex(id);
+
+    ulong dueMillis;
+
+    if (reason == ShutterReason::DEVICE_BUSY) {
+        diagnostics.busyCount++;
+    }
+
+    if (shutterIndex >= 0) {
+        // a rejected command did not move the shutter
+        if (reason != ShutterReason::DEVICE_BUSY) {
+            positionJournal.recordPosition(shutterIndex, shutters[shutterIndex].getPosition());
+        }
+        sendStatusShutterMqtt(shutterIndex);
+        traceShutterComplete(shutterIndex, reason);
+
+        // a completed STOP can still be followed by the move to the group target
+        if (!shutters[shutterIndex].getNextActionMillis(dueMillis)) {
+            groupPendingShutter[shutterIndex] = false;
+        }
+
+        if (!isGroupMovePending()) {
+            sendStatusGroupMqtt();
+        }
     }
 }
 
 void setupShutter() {
-    Log.notice("[ %s:%d ] Setup shutter 1", __FILE__, __LINE__);
-    shutter1.setControlPins(D5, D6, D7);
-    shutter1.setDurationFullMoveMs(15650);
-    shutter1.setDelayTimeMs(String(shutterDelay).toInt());
-    shutter1.onActionInProgress(shutterActionInProgress);
-    shutter1.onActionComplete(shutterActionComplete);
+    uint position;
 
-    Log.notice("[ %s:%d ] Setup shutter 2", __FILE__, __LINE__);
-    shutter2.setControlPins(D1, D2, D3);
-    shutter2.setDurationFullMoveMs(15000);
-    shutter2.setDelayTimeMs(String(shutterDelay).toInt());
-    shutter2.onActionInProgress(shutterActionInProgress);
-    shutter2.onActionComplete(shutterActionComplete);
+    positionJournal.begin();
+
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        const ShutterCalibration &calibration = shutterCalibration[i];
+
+        LOG_NOTICE("Setup shutter %d", i + 1);
+        progressShutter[i] = {0, -1, ""};
+        shutters[i].setID(SHUTTER_CONFIG[i].id);
+        shutters[i].setControlPins(calibration.pinUp, calibration.pinDown, calibration.pinStop);
+        applyShutterCalibration(i);
+        shutters[i].setDelayTimeMs(atoi(settings.shutterDelay));
+        if (positionJournal.getPosition(i, position)) {
+            shutters[i].restorePosition(position);
+        }
+        shutters[i].onActionInProgress(shutterActionInProgress);
+        shutters[i].onActionComplete(shutterActionComplete);
+    }
 }
 
 void saveConfigCallback () {
-    Log.trace("[ %s:%d ] WiFi manager registered changes, should save config", __FILE__, __LINE__);
+    LOG_TRACE("WiFi manager registered changes, should save config");
     shouldSaveConfig = true;
 }
 
 void configModeCallback (WiFiManager *myWiFiManager) {
-    Log.warning("Entered WiFi config mode with IP %s", WiFi.softAPIP().toString().c_str());
-    Log.warning("SSID '%s'", myWiFiManager->getConfigPortalSSID().c_str());
+    LOG_WARNING("Entered WiFi config mode with IP %s", WiFi.softAPIP().toString().c_str());
+    LOG_WARNING("SSID '%s'", myWiFiManager->getConfigPortalSSID().c_str());
   
     //entered config mode, make led toggle faster
     startBlinkOnboardLed(true);
@@ -411,106 +1798,143 @@ void configModeCallback (WiFiManager *myWiFiManager) {
 void onWifiConnected (const WiFiEventStationModeConnected& event) {
     char bssid[20] = {0};
     sprintf(bssid,"%02X:%02X:%02X:%02X:%02X:%02X", event.bssid[0], event.bssid[1], event.bssid[2], event.bssid[3], event.bssid[4], event.bssid[5]);
-    Log.notice("[ %s:%d ] Connected to SSID [ %s ] on BSSID [ %s ] via channel [ %d ], waiting for IP address.", __FILE__, __LINE__, event.ssid.c_str(), bssid, event.channel);
+    LOG_NOTICE("Connected to SSID [ %s ] on BSSID [ %s ] via channel [ %d ], waiting for IP address.", event.ssid.c_str(), bssid, event.channel);
 }
 
 void onWifiDisconnect(const WiFiEventStationModeDisconnected& event) {
-	Log.warning("[ %s:%d ] Disconnected from SSID [ %s ] with reason [ %d ].", __FILE__, __LINE__, event.ssid.c_str(), event.reason);
+	LOG_WARNING("Disconnected from SSID [ %s ] with reason [ %d ].", event.ssid.c_str(), event.reason);
     startBlinkOnboardLed(true);
 }
 
 void onWifiGotIP(const WiFiEventStationModeGotIP& event) {
-    Log.notice("[ %s:%d ] Received IP [ %s ] / Gateway [ %s ] / Mask [ %s ].", __FILE__, __LINE__, event.ip.toString().c_str(), event.gw.toString().c_str(), event.mask.toString().c_str());
+    LOG_NOTICE("Received IP [ %s ] / Gateway [ %s ] / Mask [ %s ].", event.ip.toString().c_str(), event.gw.toString().c_str(), event.mask.toString().c_str());
 	stopBlinkOnboardLed();
 
     MDNS.close();
     if (!MDNS.begin(clientId)) {
-        Log.error("[ %s:%d ] Error setting up MDNS responder.", __FILE__, __LINE__);
+        LOG_ERROR("Error setting up MDNS responder.");
     }
 }
 
-void setupWifiManager() {
-    char charBuffer[1024];
-    WiFiManager wifiManager;
+bool loadConfig() {
+    configStore.setDefaults(settings, shutterCalibration);
 
-    //uncomment to reset saved settings and clean file system for debug purpose
-    //wifiManager.resetSettings(); LittleFS.format();
+    LOG_NOTICE("Mounting file system");
 
-    // start blinking slow because we start in AP mode and try to connect
-    startBlinkOnboardLed();
+    if (!LittleFS.begin()) {
+        LOG_FATAL("Failed to mount file system");
+        return false;
+    }
 
-    clientId = String(CLIENT_ID_PREFIX) + String(ESP.getChipId());
-    WiFi.hostname(clientId);
-    WiFi.setAutoReconnect(true);    
+    LOG_NOTICE("Successfully mounted file system");
+    return configStore.load(settings, shutterCalibration);
+}
 
-    //read configuration from FS json
-    Log.notice("[ %s:%d ] Mounting file system", __FILE__, __LINE__);
-
-    if (LittleFS.begin()) {
-        Log.notice("[ %s:%d ] Successfully mounted file system", __FILE__, __LINE__);
-        if (LittleFS.exists("/config.json")) {
-            //file exists, reading and loading
-            Log.notice("[ %s:%d ] Reading JSON config file", __FILE__, __LINE__);
-            File configFile = LittleFS.open("/config.json", "r");
-            if (configFile) {
-                Log.notice("[ %s:%d ] Successfully opened JSON config file", __FILE__, __LINE__);
-                size_t size = configFile.size();
-                // Allocate a buffer to store contents of the file.
-                std::unique_ptr<char[]> buf(new char[size]);
-
-                configFile.readBytes(buf.get(), size);
-
-                DynamicJsonDocument json(1024);
-                auto deserializeError = deserializeJson(json, buf.get());
-                
-                if ( ! deserializeError ) {
-                    serializeJson(json, charBuffer, sizeof(charBuffer));
-                    Log.notice("[ %s:%d ] Parsed JSON", __FILE__, __LINE__);
-                    Log.notice("[ %s:%d ] %s", __FILE__, __LINE__, charBuffer);
-                    
-                    strcpy(mqttServer, json["mqtt_server"]);
-                    strcpy(mqttPort, json["mqtt_port"]);
-                    strcpy(mqttUser, json["mqtt_user"]);
-                    strcpy(mqttPassword, json["mqtt_password"]);
-                    strcpy(discoveryPrefix, json["discovery_prefix"]);
-                    strcpy(shutterDelay, json["shutter_delay"]);
-                } else {
-                    Log.error("[ %s:%d ] Failed to load JSON config file, consider reset", __FILE__, __LINE__);
-                }
-                
-                configFile.close();
-            }
-        } else {
-            Log.notice("[ %s:%d ] JSON config file does not exist", __FILE__, __LINE__);
-        }
-    } else {
-        Log.fatal("[ %s:%d ] Failed to mount file system", __FILE__, __LINE__);
+bool loadWifiCache(wifiCache_t &cache) {
+    File cacheFile = LittleFS.open(WIFI_CACHE_FILE, "r");
+    bool success;
+
+    if (!cacheFile) {
+        return false;
+    }
+
+    success = cacheFile.read((uint8_t *) &cache, sizeof(cache)) == sizeof(cache) && cache.channel >= 1 && cache.channel <= 14;
+    cacheFile.close();
+
+    return success;
+}
+
+void saveWifiCache() {
+    wifiCache_t cache;
+    wifiCache_t cachedCache;
+
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.mask = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP();
+
+    // the access point and lease hardly ever change, so the flash is rarely written
+    if (loadWifiCache(cachedCache) && memcmp(&cache, &cachedCache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    File cacheFile = LittleFS.open(WIFI_CACHE_FILE, "w");
+    if (!cacheFile) {
+        LOG_ERROR("Failed to open WiFi cache [ %s ] for writing.", WIFI_CACHE_FILE);
+        return;
+    }
+    cacheFile.write((const uint8_t *) &cache, sizeof(cache));
+    cacheFile.close();
+
+    LOG_NOTICE("Saved BSSID [ %s ] and channel [ %d ] to WiFi cache.", WiFi.BSSIDstr().c_str(), cache.channel);
+}
+
+bool connectWifiFast() {
+    wifiCache_t cache;
+    ulong startMillis = millis();
+
+    if (WiFi.SSID().length() == 0 || !loadWifiCache(cache)) {
+        LOG_NOTICE("No stored WiFi credentials or cached access point, fast boot skipped.");
+        return false;
     }
 
+    LOG_NOTICE("Fast boot to SSID [ %s ] via channel [ %d ].", WiFi.SSID().c_str(), cache.channel);
+
+    // connect straight to the known access point without scanning, the credentials are already stored
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    if (FAST_BOOT_STATIC_IP) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.mask), IPAddress(cache.dns));
+    }
+    WiFi.begin(WiFi.SSID().c_str(), WiFi.psk().c_str(), cache.channel, cache.bssid);
+
+    while (WiFi.status() != WL_CONNECTED && millis() - startMillis < FAST_BOOT_TIMEOUT_MS) {
+        delay(10);
+    }
+    WiFi.persistent(true);
+
+    if (WiFi.status() != WL_CONNECTED) {
+        LOG_WARNING("Fast boot failed after [ %l ]ms, fall back to WiFi manager.", millis() - startMillis);
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+        return false;
+    }
+
+    LOG_NOTICE("Fast boot connected after [ %l ]ms.", millis() - startMillis);
+    return true;
+}
+
+void setupWifiManager() {
+    WiFiManager wifiManager;
+
+    //uncomment to reset saved settings and clean file system for debug purpose
+    //wifiManager.resetSettings(); LittleFS.format();
+
     wifiManager.setAPCallback(configModeCallback);
     wifiManager.setSaveConfigCallback(saveConfigCallback);
 
-    WiFiManagerParameter custom_mqtt_server("server", "MQTT broker", mqttServer, sizeof(mqttServer));
+    WiFiManagerParameter custom_mqtt_server("server", "MQTT broker", settings.mqttServer, sizeof(settings.mqttServer));
     wifiManager.addParameter(&custom_mqtt_server);
 
-    WiFiManagerParameter custom_mqtt_port("port", "MQTT port", mqttPort, sizeof(mqttPort));
+    WiFiManagerParameter custom_mqtt_port("port", "MQTT port", settings.mqttPort, sizeof(settings.mqttPort));
     wifiManager.addParameter(&custom_mqtt_port);
 
-    WiFiManagerParameter custom_mqtt_user("user", "MQTT user", mqttUser, sizeof(mqttUser));
+    WiFiManagerParameter custom_mqtt_user("user", "MQTT user", settings.mqttUser, sizeof(settings.mqttUser));
     wifiManager.addParameter(&custom_mqtt_user);
 
-    WiFiManagerParameter custom_mqtt_password("password", "MQTT password", mqttPassword, sizeof(mqttPassword));
+    WiFiManagerParameter custom_mqtt_password("password", "MQTT password", settings.mqttPassword, sizeof(settings.mqttPassword));
     wifiManager.addParameter(&custom_mqtt_password);
 
-    WiFiManagerParameter custom_discovery_prefix("discovery", "Discovery prefix", discoveryPrefix, sizeof(discoveryPrefix));
+    WiFiManagerParameter custom_discovery_prefix("discovery", "Discovery prefix", settings.discoveryPrefix, sizeof(settings.discoveryPrefix));
     wifiManager.addParameter(&custom_discovery_prefix);
 
-    WiFiManagerParameter custom_shutter_delay("delay", "Shutter delay in MS", shutterDelay, 4);
+    WiFiManagerParameter custom_shutter_delay("delay", "Shutter delay in MS", settings.shutterDelay, 4);
     wifiManager.addParameter(&custom_shutter_delay);
 
     wifiManager.setTimeout(120);
     if(!wifiManager.autoConnect()) {
-        Log.fatal("[ %s:%d ] Failed to connect to WiFi and reached timeout, restart now...", __FILE__, __LINE__);
+        LOG_FATAL("Failed to connect to WiFi and reached timeout, restart now...");
         delay(3000);
         
         //reset and try again, or maybe put it to deep sleep
@@ -519,44 +1943,48 @@ void setupWifiManager() {
     } 
 
     //if you get here you have connected to the WiFi
-    Log.notice("[ %s:%d ] Connected to SSID [ %s ] on BSSID [ %s ] via channel [ %d ], waiting for IP address.", __FILE__, __LINE__, WiFi.SSID().c_str(), WiFi.BSSIDstr().c_str(), WiFi.channel());
+    LOG_NOTICE("Connected to SSID [ %s ] on BSSID [ %s ] via channel [ %d ], waiting for IP address.", WiFi.SSID().c_str(), WiFi.BSSIDstr().c_str(), WiFi.channel());
 
     //read updated parameters
-    strcpy(mqttServer, custom_mqtt_server.getValue());
-    strcpy(mqttPort, custom_mqtt_port.getValue());
-    strcpy(mqttUser, custom_mqtt_user.getValue());
-    strcpy(mqttPassword, custom_mqtt_password.getValue());
-    strcpy(discoveryPrefix, custom_discovery_prefix.getValue());
-    strcpy(shutterDelay, custom_shutter_delay.getValue());
-
-    Log.notice("[ %s:%d ] MQTT broker settings [ %s:%s ]", __FILE__, __LINE__, mqttServer, mqttPort);
-    Log.notice("[ %s:%d ] MQTT user [ %s ] and password  [ %s ]", __FILE__, __LINE__, mqttUser, mqttPassword);
-    Log.notice("[ %s:%d ] Auto discovery prefix [ %s ]", __FILE__, __LINE__, discoveryPrefix);
-    Log.notice("[ %s:%d ] Shutter delay [ %s ] ms", __FILE__, __LINE__, shutterDelay);
+    strlcpy(settings.mqttServer, custom_mqtt_server.getValue(), sizeof(settings.mqttServer));
+    strlcpy(settings.mqttPort, custom_mqtt_port.getValue(), sizeof(settings.mqttPort));
+    strlcpy(settings.mqttUser, custom_mqtt_user.getValue(), sizeof(settings.mqttUser));
+    strlcpy(settings.mqttPassword, custom_mqtt_password.getValue(), sizeof(settings.mqttPassword));
+    strlcpy(settings.discoveryPrefix, custom_discovery_prefix.getValue(), sizeof(settings.discoveryPrefix));
+    strlcpy(settings.shutterDelay, custom_shutter_delay.getValue(), sizeof(settings.shutterDelay));
+
+    LOG_NOTICE("MQTT broker settings [ %s:%s ]", settings.mqttServer, settings.mqttPort);
+    LOG_NOTICE("MQTT user [ %s ] and password  [ %s ]", settings.mqttUser, settings.mqttPassword);
+    LOG_NOTICE("Auto discovery prefix [ %s ]", settings.discoveryPrefix);
+    LOG_NOTICE("Shutter delay [ %s ] ms", settings.shutterDelay);
+
+    // shutters are already set up, the delay might just have been changed in the portal
+    for (uint i = 0; i < SHUTTER_COUNT; i++) {
+        shutters[i].setDelayTimeMs(atoi(settings.shutterDelay));
+    }
 
     //save the custom parameters to file system
     if (shouldSaveConfig) {
-        Log.notice("[ %s:%d ] Saving JSON config", __FILE__, __LINE__);
-        DynamicJsonDocument json(1024);
-        json["mqtt_server"] = mqttServer;
-        json["mqtt_port"] = mqttPort;
-        json["mqtt_user"] = mqttUser;
-        json["mqtt_password"] = mqttPassword;
-        json["discovery_prefix"] = discoveryPrefix;
-        json["shutter_delay"] = shutterDelay;
+        LOG_NOTICE("Saving config");
+        configStore.save(settings, shutterCalibration);
+    }
+}
 
-        File configFile = LittleFS.open("/config.json", "w");
-        if (!configFile) {
-            Log.error("[ %s:%d ] Failed to open JSON config file for writing", __FILE__, __LINE__);
-        }
+void setupWifi(bool configLoaded) {
+    // start blinking slow because we start in AP mode and try to connect
+    startBlinkOnboardLed();
 
-        serializeJson(json, configFile);
-        configFile.close();
+    clientId = String(CLIENT_ID_PREFIX) + String(ESP.getChipId());
+    WiFi.hostname(clientId);
+    WiFi.setAutoReconnect(true);    
 
-        serializeJson(json, charBuffer, sizeof(charBuffer));
-        Log.notice("[ %s:%d ] Successfully wrote config JSON", __FILE__, __LINE__);
-        Log.notice(charBuffer);
+    // the WiFi manager and its portal are only needed if the device is not set up yet or the access point changed
+    bootStats.fastBoot = configLoaded && connectWifiFast();
+    if (!bootStats.fastBoot) {
+        setupWifiManager();
     }
+    bootStats.wifiConnectedMillis = millis();
+    saveWifiCache();
 
     stopBlinkOnboardLed();
 
@@ -565,33 +1993,75 @@ void setupWifiManager() {
     wifiGotIpHandler = WiFi.onStationModeGotIP(onWifiGotIP);
 
     if (!MDNS.begin(clientId)) {
-        Log.error("[ %s:%d ] Error setting up MDNS responder", __FILE__, __LINE__);
+        LOG_ERROR("Error setting up MDNS responder");
     }
 }
 
 void setup() {
+    bool configLoaded;
+
     Serial.begin(115200);
     while(!Serial && !Serial.available()) {}
     Serial.println("\n");
 
-    Log.begin(LOG_LEVEL_VERBOSE, &Serial, true);
-    Log.setPrefix(printTimestamp);
-    Log.setSuffix(printNewline);
+    logBuffer.begin(&Serial);
 
     pinMode(LED_BUILTIN, OUTPUT);
 
-    Log.notice("[ %s:%d ] Project version: %s", __FILE__, __LINE__, String(VERSION).c_str());
-    Log.notice("[ %s:%d ] Build timestamp: %s", __FILE__, __LINE__, String(BUILD_TIMESTAMP).c_str());
+    LOG_NOTICE("Project version: %s", String(VERSION).c_str());
+    LOG_NOTICE("Build timestamp: %s", String(BUILD_TIMESTAMP).c_str());
 
-    setupWifiManager();
+    configLoaded = loadConfig();
+    // shutters only need the config, they are ready before the network is
     setupShutter();
+    setupWifi(configLoaded);
     setupMqtt();    
+
+    // from now on log records are only printed when the loop has nothing else to do
+    logBuffer.setDeferred(true);
+}
+
+ulong takeStageMicros(ulong &stageStartMicros) {
+    ulong nowMicros = micros();
+    ulong stageMicros = nowMicros - stageStartMicros;
+
+    stageStartMicros = nowMicros;
+    return stageMicros;
+}
+
+void measureStage(LatencyHistogram &histogram, ulong &stageStartMicros) {
+    histogram.add(takeStageMicros(stageStartMicros));
 }
 
 void loop() {
+    ulong loopStartMicros = micros();
+    ulong stageStartMicros = loopStartMicros;
+    ulong publishMicros;
+
+    // shutter deadlines are served before and after the network work, which can block for a while
+    workShutters();
+    measureStage(diagnostics.shutters, stageStartMicros);
     MDNS.update();
+    measureStage(diagnostics.mdns, stageStartMicros);
     checkMqttConnection();
-    shutter1.tick();
-    shutter2.tick();
+    measureStage(diagnostics.mqtt, stageStartMicros);
+    workShutters();
+    measureStage(diagnostics.shutters, stageStartMicros);
     workProcessQueue();
+    measureStage(diagnostics.queue, stageStartMicros);
+    // the log is drained between the publishes, both parts of the publish stage count as one duration
+    workProgress();
+    publishMicros = takeStageMicros(stageStartMicros);
+    workLog();
+    measureStage(diagnostics.log, stageStartMicros);
+    workDiagnostics();
+    workRejectNotification();
+    diagnostics.publish.add(publishMicros + takeStageMicros(stageStartMicros));
+    workJournal();
+    workConfigSave();
+    measureStage(diagnostics.flash, stageStartMicros);
+
+    // the idle time is not part of the iteration, it is given away on purpose
+    diagnostics.loop.add(stageStartMicros - loopStartMicros);
+    idleUntilNextDeadline();
 }
\ No newline at end of file
@@ -0,0 +1,459 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <stdarg.h>
+
+#include <chrono>
+#include <new>
+
+#include "../../src/main.cpp"
+
+/* calls of each benchmarked function, enough to keep the clock resolution out of the result */
+#define BENCHMARK_ITERATIONS 200000
+
+/* virtual time a received command may take until the first button of the remote is pressed */
+#define COMMAND_LATENCY_MAX_MS 20
+
+// every allocation on the heap passes here, so a benchmark can tell how many allocations a call needs
+ulong allocationCount = 0;
+
+void *operator new(size_t size) {
+    void *memory = malloc(size > 0 ? size : 1);
+
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    allocationCount++;
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t size) noexcept {
+    free(memory);
+}
+
+typedef struct {
+    double nsPerOp;
+    double allocsPerOp;
+} benchmarkResult_t;
+
+// keeps the compiler from dropping calls whose results are not used otherwise
+volatile long benchmarkSink;
+
+template<typename Function>
+benchmarkResult_t runBenchmark(const char *name, Function function) {
+    benchmarkResult_t result;
+    ulong allocationsBefore;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+
+    // one call ahead, so a lazy initialization is not counted
+    benchmarkSink = function();
+
+    allocationsBefore = allocationCount;
+    begin = std::chrono::steady_clock::now();
+    for (uint i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        benchmarkSink = function();
+    }
+    end = std::chrono::steady_clock::now();
+
+    result.nsPerOp = std::chrono::duration<double, std::nano>(end - begin).count() / BENCHMARK_ITERATIONS;
+    result.allocsPerOp = (double) (allocationCount - allocationsBefore) / BENCHMARK_ITERATIONS;
+    printf("BENCHMARK %-40s %10.1f ns/op %6.2f allocs/op\n", name, result.nsPerOp, result.allocsPerOp);
+
+    return result;
+}
+
+std::string deviceTopic(const char *subTopic) {
+    return std::string(clientId.c_str()) + "/" + subTopic;
+}
+
+// runs the loop like on the device, an iteration with nothing to idle for takes a millisecond
+void runLoop(ulong ms) {
+    ulong endMillis = millis() + ms;
+    ulong iterationMillis;
+
+    while ((long) (millis() - endMillis) < 0) {
+        iterationMillis = millis();
+        loop();
+        if (millis() == iterationMillis) {
+            nativeHost.advanceMillis(1);
+        }
+    }
+    nativeHost.takeSerial();
+}
+
+bool isButtonPressed() {
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.value == HIGH) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// hands the command to the broker and counts loop iterations and virtual time until a button goes high
+void measureCommandLatency(const char *name, const char *subTopic, const char *payload) {
+    ulong receivedMillis = millis();
+    ulong latencyMillis;
+    uint iterations = 0;
+    ulong iterationMillis;
+
+    nativeHost.clearPinWrites();
+    nativeHost.receiveMqtt(receivedMillis, deviceTopic(subTopic), payload);
+
+    while (!isButtonPressed() && millis() - receivedMillis <= COMMAND_LATENCY_MAX_MS) {
+        iterationMillis = millis();
+        loop();
+        iterations++;
+        if (millis() == iterationMillis && !isButtonPressed()) {
+            nativeHost.advanceMillis(1);
+        }
+    }
+    latencyMillis = nativeHost.getPinWrites().empty() ? millis() - receivedMillis : nativeHost.getPinWrites().front().millis - receivedMillis;
+    printf("BENCHMARK %-40s %10lu ms %6u iterations\n", name, latencyMillis, iterations);
+
+    TEST_ASSERT_TRUE(isButtonPressed());
+    TEST_ASSERT_LESS_OR_EQUAL(COMMAND_LATENCY_MAX_MS, latencyMillis);
+
+    // the shutter finishes the command and its hold-off before the next measurement
+    runLoop(60000);
+}
+
+// the virtual clock is held, so every iteration sees the same pending deadlines and an idle delay() is undone
+long loopAtHeldClock() {
+    ulong heldMillis = millis();
+
+    loop();
+    nativeHost.setMillis(heldMillis);
+    return (long) heldMillis;
+}
+
+// takes the log output without printing it, so the log benchmarks do not measure the host serial
+class DiscardingPrint : public Print {
+
+public:
+    size_t write(uint8_t c) override {
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        return size;
+    }
+
+};
+
+DiscardingPrint discardingOutput;
+
+// stand-in for the former Log.notice() of ArduinoLog, which is not linked into the native build, it prints the
+// timestamp prefix and formats the arguments straight into the output like ArduinoLog does
+void logNoticeDirect(Print *output, const char *format, ...) {
+    char prefix[12];
+    va_list args;
+
+    sprintf(prefix, "%10lu ", millis());
+    output->print(prefix);
+    output->print("N: ");
+
+    va_start(args, format);
+    for (const char *c = format; *c != '\0'; c++) {
+        if (*c != '%' || *(c + 1) == '\0') {
+            output->print(*c);
+            continue;
+        }
+        c++;
+
+        if (*c == 's') {
+            output->print(va_arg(args, const char *));
+        } else if (*c == 'l') {
+            output->print(va_arg(args, long));
+        } else if (*c == 'd') {
+            output->print(va_arg(args, int));
+        } else {
+            output->print(*c);
+        }
+    }
+    va_end(args);
+
+    output->print('\n');
+}
+
+// LOG_NOTICE expands to log() of the global buffer, here a fresh buffer for every call keeps room for the record
+template<typename... Args>
+long logNoticeDeferred(const char *format, Args... args) {
+    LogBuffer buffer;
+
+    buffer.setDeferred(true);
+    buffer.log(LOG_LEVEL_NOTICE, __FILE__, __LINE__, format, args...);
+    return buffer.isEmpty() ? 0 : 1;
+}
+
+// packed and printed by the drain afterwards, what LOG_NOTICE costs in total
+template<typename... Args>
+long logNoticeDrained(const char *format, Args... args) {
+    static LogBuffer buffer;
+
+    buffer.begin(&discardingOutput);
+    buffer.setDeferred(true);
+    buffer.log(LOG_LEVEL_NOTICE, __FILE__, __LINE__, format, args...);
+    return buffer.drain(1);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_command_to_gpio_latency() {
+    measureCommandLatency("command to GPIO shutter1/set down", "shutter1/set", "down");
+    measureCommandLatency("command to GPIO shutter2/set_position 40", "shutter2/set_position", "40");
+    measureCommandLatency("command to GPIO shutter1/set up", "shutter1/set", "up");
+}
+
+void test_loop_iteration_cost() {
+    runBenchmark("loop() idle", loopAtHeldClock);
+    nativeHost.takeSerial();
+
+    // a partial move keeps the shutter waiting for its STOP, every iteration checks the deadline
+    nativeHost.receiveMqtt(millis(), deviceTopic("shutter2/set_position"), "90");
+    runLoop(200);
+    runBenchmark("loop() while waiting for STOP", loopAtHeldClock);
+    nativeHost.takeSerial();
+    runLoop(60000);
+}
+
+void test_position_from_payload() {
+    benchmarkResult_t result;
+
+    result = runBenchmark("getPositionFromPayload(\" 42 \")", []() {
+        return (long) getPositionFromPayload(" 42 ");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    result = runBenchmark("getPositionFromPayload(\"stop\")", []() {
+        return (long) getPositionFromPayload("stop");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+}
+
+void test_shutter_action_from_payload() {
+    benchmarkResult_t result;
+
+    result = runBenchmark("getShutterActionFromPayload(\"UP\")", []() {
+        return (long) getShutterActionFromPayload("UP");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    result = runBenchmark("getShutterActionFromPayload(\"open\")", []() {
+        return (long) getShutterActionFromPayload("open");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+}
+
+// the first resolver, getMqttModeFromTopic() and buildMqttTopic() of the initial version for any number of shutters,
+// it built the prefix of every shutter as String for each message and matched the command by its end
+String buildMqttTopicByString(String subTopic, MqttMode mqttMode, uint shutterNo) {
+    String mqttTopic;
+
+    if (mqttMode == MqttMode::GLOBAL) {
+        mqttTopic = String(CLIENT_ID_PREFIX) + "s/";
+    } else {
+        mqttTopic = clientId + "/";
+    }
+
+    if (mqttMode == MqttMode::SHUTTER) {
+        mqttTopic += "shutter" + String(shutterNo) + "/";
+    }
+    mqttTopic += subTopic;
+
+    return mqttTopic;
+}
+
+bool resolveMqttTopicByString(String topic, MqttMode &mqttMode, uint8_t &shutterIndex, MqttCommand &mqttCommand) {
+    mqttMode = MqttMode::INVALID_MQTT_MODE;
+    mqttCommand = MqttCommand::INVALID_MQTT_COMMAND;
+
+    for (uint i = 0; i < SHUTTER_COUNT && mqttMode == MqttMode::INVALID_MQTT_MODE; i++) {
+        if (topic.startsWith(buildMqttTopicByString("", MqttMode::SHUTTER, i + 1))) {
+            mqttMode = MqttMode::SHUTTER;
+            shutterIndex = i;
+        }
+    }
+    if (mqttMode == MqttMode::INVALID_MQTT_MODE) {
+        if (topic.startsWith(buildMqttTopicByString("", MqttMode::DEVICE, 0))) {
+            mqttMode = MqttMode::DEVICE;
+        } else if (topic.startsWith(buildMqttTopicByString("", MqttMode::GLOBAL, 0))) {
+            mqttMode = MqttMode::GLOBAL;
+        }
+    }
+
+    if (topic.endsWith("set_position")) {
+        mqttCommand = MqttCommand::SET_POSITION;
+    } else if (topic.endsWith("set")) {
+        mqttCommand = MqttCommand::SET;
+    }
+
+    return mqttMode != MqttMode::INVALID_MQTT_MODE && mqttCommand != MqttCommand::INVALID_MQTT_COMMAND;
+}
+
+void test_resolve_mqtt_topic() {
+    static std::string shutterTopic = deviceTopic("shutter2/set_position");
+    static std::string groupTopic = deviceTopic("group/set");
+    benchmarkResult_t result;
+
+    // the first resolver knew no group, it is only compared for a shutter and allowed to allocate
+    runBenchmark("resolveMqttTopicByString(shutter#/set_position)", []() {
+        MqttMode mqttMode;
+        uint8_t shutterIndex;
+        MqttCommand mqttCommand;
+
+        return (long) resolveMqttTopicByString(shutterTopic.c_str(), mqttMode, shutterIndex, mqttCommand);
+    });
+
+    result = runBenchmark("resolveMqttTopic(shutter#/set_position)", []() {
+        MqttMode mqttMode;
+        uint8_t shutterIndex;
+        MqttCommand mqttCommand;
+
+        return (long) resolveMqttTopic(shutterTopic.c_str(), mqttMode, shutterIndex, mqttCommand);
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    result = runBenchmark("resolveMqttTopic(group/set)", []() {
+        MqttMode mqttMode;
+        uint8_t shutterIndex;
+        MqttCommand mqttCommand;
+
+        return (long) resolveMqttTopic(groupTopic.c_str(), mqttMode, shutterIndex, mqttCommand);
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+}
+
+void test_parse_mqtt_batch() {
+    benchmarkResult_t result;
+
+    result = runBenchmark("parseMqttBatch(\"1:20, 2:down\")", []() {
+        const char *payload = "1:20, 2:down";
+        mqttBatch_t batch;
+
+        return (long) parseMqttBatch((const byte *) payload, strlen(payload), batch);
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+}
+
+void test_mqtt_callback() {
+    static std::string setTopic = deviceTopic("shutter1/set");
+    static std::string setPositionTopic = deviceTopic("shutter2/set_position");
+    static std::string batchTopic = deviceTopic("batch/set");
+    static std::string calibrateTopic = deviceTopic("shutter1/calibrate");
+    benchmarkResult_t result;
+
+    // the client hands over its own buffers, the same message is received again and again, so each call replaces
+    // the pending command of the previous one
+    result = runBenchmark("mqttCallback(shutter1/set down)", []() {
+        static char payload[] = "down";
+
+        mqttCallback((char *) setTopic.c_str(), (byte *) payload, strlen(payload));
+        return 0L;
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    result = runBenchmark("mqttCallback(shutter2/set_position 40)", []() {
+        static char payload[] = "40";
+
+        mqttCallback((char *) setPositionTopic.c_str(), (byte *) payload, strlen(payload));
+        return 0L;
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    result = runBenchmark("mqttCallback(batch/set 1:20, 2:down)", []() {
+        static char payload[] = "1:20, 2:down";
+
+        mqttCallback((char *) batchTopic.c_str(), (byte *) payload, strlen(payload));
+        return 0L;
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    // the calibration of the shutter table, so the following benchmarks run with unchanged durations
+    result = runBenchmark("mqttCallback(shutter1/calibrate)", []() {
+        static char payload[] = "15650,15650,100,100,0";
+
+        mqttCallback((char *) calibrateTopic.c_str(), (byte *) payload, strlen(payload));
+        return 0L;
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    nativeHost.takeSerial();
+    runLoop(60000);
+}
+
+#define LOG_BENCHMARK_STRING_FORMAT "MQTT message arrived and enqueued with topic [ %s ] and payload [ %s ]."
+#define LOG_BENCHMARK_INTEGER_FORMAT "Calibration of shutter [ %d ] set to up [ %l ]ms, down [ %l ]ms, press [ %d ]ms, latency [ %d / %d ]ms."
+
+void test_log_notice() {
+    benchmarkResult_t result;
+
+    // the stand-in of the former path formats and prints at the call site, LOG_NOTICE only packs the record there
+    runBenchmark("logNoticeDirect() strings", []() {
+        logNoticeDirect(&discardingOutput, "[ %s:%d ] " LOG_BENCHMARK_STRING_FORMAT, __FILE__, __LINE__, "ESP1234567/shutter1/set", "down");
+        return 0L;
+    });
+    result = runBenchmark("LOG_NOTICE() strings", []() {
+        return logNoticeDeferred(LOG_BENCHMARK_STRING_FORMAT, "ESP1234567/shutter1/set", "down");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+    result = runBenchmark("LOG_NOTICE() strings with drain", []() {
+        return logNoticeDrained(LOG_BENCHMARK_STRING_FORMAT, "ESP1234567/shutter1/set", "down");
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+
+    runBenchmark("logNoticeDirect() integers", []() {
+        logNoticeDirect(&discardingOutput, "[ %s:%d ] " LOG_BENCHMARK_INTEGER_FORMAT, __FILE__, __LINE__, 1, 15650L, 15650L, 100, 100, 0);
+        return 0L;
+    });
+    result = runBenchmark("LOG_NOTICE() integers", []() {
+        return logNoticeDeferred(LOG_BENCHMARK_INTEGER_FORMAT, 1, 15650L, 15650L, 100, 100, 0);
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+    result = runBenchmark("LOG_NOTICE() integers with drain", []() {
+        return logNoticeDrained(LOG_BENCHMARK_INTEGER_FORMAT, 1, 15650L, 15650L, 100, 100, 0);
+    });
+    TEST_ASSERT_EQUAL(0, result.allocsPerOp);
+}
+
+void test_discovery_json() {
+    // only reported, the allocations depend on the ArduinoJson version and StaticJsonDocument should need none
+    runBenchmark("buildDiscoveryJson()", []() {
+        StaticJsonDocument<DISCOVERY_JSON_CAPACITY> doc;
+        discoveryTopics_t topics;
+
+        buildDiscoveryJson("Shutter 1", "ESP1234567-shutter-1", 0, topics, doc);
+        return (long) doc.memoryUsage();
+    });
+}
+
+int main(int argc, char **argv) {
+    // the shutters, the topic table and the broker connection are set up like on the device
+    setup();
+    while (!mqttClient.connected()) {
+        runLoop(1);
+    }
+    // the virtual clock starts at one second, the hold-off of the remotes after boot has to pass first
+    runLoop(2000);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_command_to_gpio_latency);
+    RUN_TEST(test_loop_iteration_cost);
+    RUN_TEST(test_position_from_payload);
+    RUN_TEST(test_shutter_action_from_payload);
+    RUN_TEST(test_resolve_mqtt_topic);
+    RUN_TEST(test_parse_mqtt_batch);
+    RUN_TEST(test_mqtt_callback);
+    RUN_TEST(test_log_notice);
+    RUN_TEST(test_discovery_json);
+    return UNITY_END();
+}
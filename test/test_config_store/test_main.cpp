@@ -0,0 +1,97 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "ConfigStore.hpp"
+
+DeviceSettings settings;
+ShutterCalibration calibration[SHUTTER_COUNT];
+
+void setUp() {
+    nativeHost.reset();
+    configStore.setDefaults(settings, calibration);
+}
+
+void tearDown() {
+}
+
+void test_missing_config_keeps_defaults() {
+    TEST_ASSERT_FALSE(configStore.load(settings, calibration));
+    TEST_ASSERT_EQUAL_STRING("1883", settings.mqttPort);
+    TEST_ASSERT_EQUAL(SHUTTER_CONFIG[0].durationUpMs, calibration[0].durationUpMs);
+}
+
+void test_saved_config_is_loaded() {
+    DeviceSettings loadedSettings;
+    ShutterCalibration loadedCalibration[SHUTTER_COUNT];
+
+    strcpy(settings.mqttServer, "broker.local");
+    calibration[1].durationDownMs = 12345;
+    calibration[1].stopLatencyMs = 150;
+    TEST_ASSERT_TRUE(configStore.save(settings, calibration));
+
+    configStore.setDefaults(loadedSettings, loadedCalibration);
+    TEST_ASSERT_TRUE(configStore.load(loadedSettings, loadedCalibration));
+    TEST_ASSERT_EQUAL_STRING("broker.local", loadedSettings.mqttServer);
+    TEST_ASSERT_EQUAL(12345, loadedCalibration[1].durationDownMs);
+    TEST_ASSERT_EQUAL(150, loadedCalibration[1].stopLatencyMs);
+}
+
+void test_corrupted_config_is_ignored() {
+    DeviceSettings loadedSettings;
+    ShutterCalibration loadedCalibration[SHUTTER_COUNT];
+
+    strcpy(settings.mqttServer, "broker.local");
+    configStore.save(settings, calibration);
+
+    // a flipped bit in the server name only shows up in the CRC
+    nativeHost.files[CONFIG_FILE][8] ^= 0x01;
+
+    configStore.setDefaults(loadedSettings, loadedCalibration);
+    TEST_ASSERT_FALSE(configStore.load(loadedSettings, loadedCalibration));
+    TEST_ASSERT_EQUAL_STRING("", loadedSettings.mqttServer);
+}
+
+void test_torn_save_keeps_previous_config() {
+    DeviceSettings loadedSettings;
+    ShutterCalibration loadedCalibration[SHUTTER_COUNT];
+
+    strcpy(settings.mqttServer, "broker.local");
+    configStore.save(settings, calibration);
+    TEST_ASSERT_FALSE(LittleFS.exists(CONFIG_TEMP_FILE));
+
+    // a power loss while the next save was written leaves the temporary file behind
+    nativeHost.files[CONFIG_TEMP_FILE] = nativeHost.files[CONFIG_FILE].substr(0, 20);
+
+    configStore.setDefaults(loadedSettings, loadedCalibration);
+    TEST_ASSERT_TRUE(configStore.load(loadedSettings, loadedCalibration));
+    TEST_ASSERT_EQUAL_STRING("broker.local", loadedSettings.mqttServer);
+}
+
+void test_json_config_is_migrated_once() {
+    DeviceSettings loadedSettings;
+    ShutterCalibration loadedCalibration[SHUTTER_COUNT];
+
+    nativeHost.files[CONFIG_JSON_FILE] = "{\"mqtt_server\":\"old.local\",\"mqtt_port\":\"1884\",\"shutter_delay\":\"900\"}";
+
+    TEST_ASSERT_TRUE(configStore.load(settings, calibration));
+    TEST_ASSERT_EQUAL_STRING("old.local", settings.mqttServer);
+    TEST_ASSERT_EQUAL_STRING("1884", settings.mqttPort);
+    TEST_ASSERT_EQUAL_STRING("900", settings.shutterDelay);
+    TEST_ASSERT_EQUAL_STRING("homeassistant", settings.discoveryPrefix);
+    TEST_ASSERT_FALSE(LittleFS.exists(CONFIG_JSON_FILE));
+
+    configStore.setDefaults(loadedSettings, loadedCalibration);
+    TEST_ASSERT_TRUE(configStore.load(loadedSettings, loadedCalibration));
+    TEST_ASSERT_EQUAL_STRING("old.local", loadedSettings.mqttServer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_missing_config_keeps_defaults);
+    RUN_TEST(test_saved_config_is_loaded);
+    RUN_TEST(test_corrupted_config_is_ignored);
+    RUN_TEST(test_torn_save_keeps_previous_config);
+    RUN_TEST(test_json_config_is_migrated_once);
+    return UNITY_END();
+}
@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include <limits.h>
+#include <unity.h>
+
+#include "DeadlineScheduler.hpp"
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_nothing_due_without_deadlines() {
+    DeadlineScheduler scheduler;
+    uint id;
+
+    TEST_ASSERT_FALSE(scheduler.popDue(1000, id));
+    TEST_ASSERT_EQUAL(ULONG_MAX, scheduler.getNextDueInMs(1000));
+}
+
+void test_deadlines_pop_in_order_of_due_time() {
+    DeadlineScheduler scheduler;
+    uint id;
+
+    scheduler.schedule(1, 1200);
+    scheduler.schedule(0, 1100);
+
+    TEST_ASSERT_EQUAL(100, scheduler.getNextDueInMs(1000));
+    TEST_ASSERT_FALSE(scheduler.popDue(1099, id));
+    TEST_ASSERT_TRUE(scheduler.popDue(1300, id));
+    TEST_ASSERT_EQUAL(0, id);
+    TEST_ASSERT_TRUE(scheduler.popDue(1300, id));
+    TEST_ASSERT_EQUAL(1, id);
+    TEST_ASSERT_FALSE(scheduler.popDue(1300, id));
+}
+
+void test_schedule_replaces_deadline_of_id() {
+    DeadlineScheduler scheduler;
+    uint id;
+
+    scheduler.schedule(0, 1100);
+    scheduler.schedule(1, 1200);
+    scheduler.schedule(0, 1300);
+
+    TEST_ASSERT_TRUE(scheduler.popDue(1250, id));
+    TEST_ASSERT_EQUAL(1, id);
+    TEST_ASSERT_FALSE(scheduler.popDue(1250, id));
+    TEST_ASSERT_EQUAL(50, scheduler.getNextDueInMs(1250));
+}
+
+void test_cancel_removes_deadline() {
+    DeadlineScheduler scheduler;
+    uint id;
+
+    scheduler.schedule(0, 1100);
+    scheduler.schedule(1, 1200);
+    scheduler.cancel(0);
+    scheduler.cancel(0);
+
+    TEST_ASSERT_TRUE(scheduler.popDue(1200, id));
+    TEST_ASSERT_EQUAL(1, id);
+    TEST_ASSERT_FALSE(scheduler.popDue(1200, id));
+}
+
+void test_deadlines_across_millis_overflow() {
+    DeadlineScheduler scheduler;
+    uint id;
+
+    // the earlier deadline is before the overflow of millis(), the later one after it
+    scheduler.schedule(1, 50);
+    scheduler.schedule(0, ULONG_MAX - 50);
+
+    TEST_ASSERT_EQUAL(0, scheduler.getNextDueInMs(ULONG_MAX));
+    TEST_ASSERT_TRUE(scheduler.popDue(ULONG_MAX, id));
+    TEST_ASSERT_EQUAL(0, id);
+    TEST_ASSERT_EQUAL(51, scheduler.getNextDueInMs(ULONG_MAX));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_due_without_deadlines);
+    RUN_TEST(test_deadlines_pop_in_order_of_due_time);
+    RUN_TEST(test_schedule_replaces_deadline_of_id);
+    RUN_TEST(test_cancel_removes_deadline);
+    RUN_TEST(test_deadlines_across_millis_overflow);
+    return UNITY_END();
+}
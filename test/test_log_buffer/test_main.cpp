@@ -0,0 +1,88 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "LogBuffer.hpp"
+
+void setUp() {
+    nativeHost.reset();
+}
+
+void tearDown() {
+}
+
+void test_records_are_printed_right_away_until_deferred() {
+    LogBuffer buffer;
+    std::string serial;
+
+    buffer.begin(&Serial);
+    buffer.log(LOG_LEVEL_NOTICE, "file.cpp", 12, "value [ %d ] of [ %s ]", 42, "shutter");
+    serial = nativeHost.takeSerial();
+
+    TEST_ASSERT_TRUE(buffer.isEmpty());
+    TEST_ASSERT_EQUAL_STRING("      1000 N: [ file.cpp:12 ] value [ 42 ] of [ shutter ]\n", serial.c_str());
+}
+
+void test_deferred_records_keep_their_arguments() {
+    LogBuffer buffer;
+    std::string serial;
+    char value[8] = "before";
+
+    // the string is copied into the record, changing it afterwards does not change the log
+    buffer.begin(&Serial);
+    buffer.setDeferred(true);
+    buffer.log(LOG_LEVEL_WARNING, "file.cpp", 1, "%s %l %T", value, 123456789L, true);
+    strcpy(value, "after");
+    nativeHost.advanceMillis(5);
+
+    TEST_ASSERT_EQUAL(0, nativeHost.takeSerial().size());
+    TEST_ASSERT_EQUAL(1, buffer.drain(10));
+    serial = nativeHost.takeSerial();
+    TEST_ASSERT_EQUAL_STRING("      1000 W: [ file.cpp:1 ] before 123456789 true\n", serial.c_str());
+}
+
+void test_drain_is_limited_per_call() {
+    LogBuffer buffer;
+
+    buffer.begin(&Serial);
+    buffer.setDeferred(true);
+    for (int i = 0; i < 3; i++) {
+        buffer.log(LOG_LEVEL_NOTICE, "file.cpp", 1, "%d", i);
+    }
+
+    TEST_ASSERT_EQUAL(2, buffer.drain(2));
+    TEST_ASSERT_FALSE(buffer.isEmpty());
+    TEST_ASSERT_EQUAL(1, buffer.drain(2));
+    TEST_ASSERT_TRUE(buffer.isEmpty());
+}
+
+void test_full_buffer_drops_and_reports_records() {
+    LogBuffer buffer;
+    std::string serial;
+    uint logged = 0;
+
+    buffer.begin(&Serial);
+    buffer.setDeferred(true);
+    while (buffer.getDroppedCount() == 0) {
+        buffer.log(LOG_LEVEL_NOTICE, "file.cpp", 1, "record %d", logged++);
+    }
+    buffer.log(LOG_LEVEL_NOTICE, "file.cpp", 1, "record %d", logged++);
+
+    buffer.drain(1);
+    serial = nativeHost.takeSerial();
+    TEST_ASSERT_EQUAL(0, serial.find("Log buffer full, records dropped: 2\n"));
+    TEST_ASSERT_TRUE(serial.find("record 0\n") != std::string::npos);
+
+    // the drop is only reported once
+    buffer.drain(1);
+    TEST_ASSERT_TRUE(nativeHost.takeSerial().find("dropped") == std::string::npos);
+    TEST_ASSERT_EQUAL(2, buffer.getDroppedCount());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_are_printed_right_away_until_deferred);
+    RUN_TEST(test_deferred_records_keep_their_arguments);
+    RUN_TEST(test_drain_is_limited_per_call);
+    RUN_TEST(test_full_buffer_drops_and_reports_records);
+    return UNITY_END();
+}
@@ -0,0 +1,429 @@
+#include <Arduino.h>
+#include <unity.h>
+
+// the firmware is built as a whole, the tests drive its loop on the virtual clock
+#define MQTT_STATE_JSON true
+#include "../../src/main.cpp"
+
+void setUp() {
+    nativeHost.clearPublished();
+}
+
+void tearDown() {
+}
+
+// runs the loop like on the device, an iteration with nothing to idle for takes a millisecond
+void runLoop(ulong ms) {
+    ulong endMillis = millis() + ms;
+    ulong iterationMillis;
+
+    while ((long) (millis() - endMillis) < 0) {
+        iterationMillis = millis();
+        loop();
+        if (millis() == iterationMillis) {
+            nativeHost.advanceMillis(1);
+        }
+    }
+}
+
+void receive(const char *topic, const char *payload) {
+    char topicBuffer[MQTT_TOPIC_MAX_LENGTH];
+
+    strlcpy(topicBuffer, topic, sizeof(topicBuffer));
+    mqttCallback(topicBuffer, (byte *) payload, strlen(payload));
+}
+
+uint getPublishedCount(const char *topic) {
+    uint count = 0;
+
+    for (const NativeMqttMessage &message : nativeHost.getPublished()) {
+        if (message.topic == topic) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_topics_are_resolved() {
+    MqttMode mqttMode;
+    uint8_t shutterIndex;
+    MqttCommand mqttCommand;
+
+    TEST_ASSERT_TRUE(resolveMqttTopic("ESP1234567/shutter2/set_position", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_EQUAL(MqttMode::SHUTTER, mqttMode);
+    TEST_ASSERT_EQUAL(1, shutterIndex);
+    TEST_ASSERT_EQUAL(MqttCommand::SET_POSITION, mqttCommand);
+
+    TEST_ASSERT_TRUE(resolveMqttTopic("ESP1234567/group/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_EQUAL(MqttMode::GROUP, mqttMode);
+    TEST_ASSERT_EQUAL(MqttCommand::SET, mqttCommand);
+
+    TEST_ASSERT_TRUE(resolveMqttTopic("ESPs/cmd", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_EQUAL(MqttMode::GLOBAL, mqttMode);
+
+    TEST_ASSERT_TRUE(resolveMqttTopic("ESP1234567/batch/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_EQUAL(MqttMode::DEVICE, mqttMode);
+    TEST_ASSERT_EQUAL(MqttCommand::BATCH, mqttCommand);
+
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/shutter3/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/shutter0/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/shutter12/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/shutter01/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/s/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/grid/set", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/group/setting", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP1234567/shutter1/state", mqttMode, shutterIndex, mqttCommand));
+    TEST_ASSERT_FALSE(resolveMqttTopic("ESP7654321/shutter1/set", mqttMode, shutterIndex, mqttCommand));
+}
+
+void test_topics_are_built() {
+    char topic[MQTT_TOPIC_MAX_LENGTH];
+
+    buildScopeTopic(topic, sizeof(topic), 1, "set_position");
+    TEST_ASSERT_EQUAL_STRING("ESP1234567/shutter2/set_position", topic);
+    buildScopeTopic(topic, sizeof(topic), MQTT_GROUP_SCOPE, "state");
+    TEST_ASSERT_EQUAL_STRING("ESP1234567/group/state", topic);
+    buildDeviceTopic(topic, sizeof(topic), "availability");
+    TEST_ASSERT_EQUAL_STRING("ESP1234567/availability", topic);
+
+    // the table holds no full topic, it needs less than half a topic buffer per scope
+    TEST_ASSERT_LESS_OR_EQUAL(MQTT_TOPIC_MAX_LENGTH * (SHUTTER_COUNT + 1) / 2, sizeof(mqttTopics));
+}
+
+void test_payloads_are_parsed() {
+    TEST_ASSERT_EQUAL(42, getPositionFromPayload(" 42 "));
+    TEST_ASSERT_EQUAL(100, getPositionFromPayload("100"));
+    TEST_ASSERT_EQUAL(-1, getPositionFromPayload("101"));
+    TEST_ASSERT_EQUAL(-1, getPositionFromPayload("4 2"));
+    TEST_ASSERT_EQUAL(-1, getPositionFromPayload(""));
+
+    TEST_ASSERT_EQUAL(ShutterAction::UP, getShutterActionFromPayload("UP"));
+    TEST_ASSERT_EQUAL(ShutterAction::STOP, getShutterActionFromPayload("stop"));
+    TEST_ASSERT_EQUAL(ShutterAction::UNDEFINED_ACTION, getShutterActionFromPayload("open"));
+}
+
+void test_batch_is_parsed_as_a_whole() {
+    const char *payload = " 2 : up , 1:40";
+    mqttBatch_t batch;
+
+    TEST_ASSERT_TRUE(parseMqttBatch((const byte *) payload, strlen(payload), batch));
+    TEST_ASSERT_EQUAL(ShutterAction::MOVE_BY_POSITION, batch.shutterAction[0]);
+    TEST_ASSERT_EQUAL(40, batch.position[0]);
+    TEST_ASSERT_EQUAL(ShutterAction::UP, batch.shutterAction[1]);
+
+    TEST_ASSERT_FALSE(parseMqttBatch((const byte *) "1:40,3:up", 9, batch));
+    TEST_ASSERT_FALSE(parseMqttBatch((const byte *) "1:open", 6, batch));
+    TEST_ASSERT_FALSE(parseMqttBatch((const byte *) "", 0, batch));
+}
+
+void test_newer_command_supersedes_pending_one() {
+    ulong coalescedCount = mqttCoalescedCount;
+
+    // the first command keeps the shutter busy, of the two waiting behind it only the last one is executed
+    receive("ESP1234567/shutter1/set", "down");
+    runLoop(20000);
+    receive("ESP1234567/shutter1/set_position", "40");
+    receive("ESP1234567/shutter1/set_position", "60");
+    runLoop(20000);
+
+    TEST_ASSERT_EQUAL(coalescedCount + 1, mqttCoalescedCount);
+    TEST_ASSERT_EQUAL(60, shutters[0].getPosition());
+}
+
+bool isPinPressed(uint8_t pin) {
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.pin == pin && pinWrite.value == HIGH) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* loop iterations a STOP may take from the MQTT client until its button is pressed */
+#define STOP_LATENCY_MAX_ITERATIONS 1
+
+void test_stop_is_applied_right_away() {
+    ulong receivedMillis;
+    ulong iterationMillis;
+    uint iterations = 0;
+
+    receive("ESP1234567/shutter2/set", "down");
+    runLoop(2000);
+    TEST_ASSERT_TRUE(shutters[1].isMoving());
+
+    // all slots are taken, the pending command was sent before the STOP and must not restart the shutter
+    receive("ESP1234567/shutter2/set", "up");
+    for (uint i = 1; i < MQTT_POOL_SIZE; i++) {
+        receive("ESPs/cmd", "announce");
+    }
+    TEST_ASSERT_TRUE(mqttPoolFreeSlots.isEmpty());
+
+    nativeHost.clearPinWrites();
+    receivedMillis = millis();
+    nativeHost.receiveMqtt(receivedMillis, "ESP1234567/shutter2/set", "stop");
+    while (!isPinPressed(SHUTTER_CONFIG[1].pinStop) && iterations < STOP_LATENCY_MAX_ITERATIONS) {
+        iterationMillis = millis();
+        loop();
+        iterations++;
+        if (millis() == iterationMillis) {
+            nativeHost.advanceMillis(1);
+        }
+    }
+
+    TEST_ASSERT_TRUE(isPinPressed(SHUTTER_CONFIG[1].pinStop));
+    TEST_ASSERT_EQUAL(receivedMillis, nativeHost.getPinWrites().front().millis);
+
+    runLoop(20000);
+    TEST_ASSERT_FALSE(shutters[1].isActionInProgress());
+    TEST_ASSERT_TRUE(shutters[1].getPosition() > 0 && shutters[1].getPosition() < 100);
+}
+
+void test_full_pool_rejects_newest_message() {
+    ulong rejectedCount = mqttRejectedCount;
+
+    for (uint i = 0; i <= MQTT_POOL_SIZE; i++) {
+        receive("ESP1234567/group/set", i % 2 == 0 ? "up" : "down");
+    }
+
+    TEST_ASSERT_EQUAL(rejectedCount + 1, mqttRejectedCount);
+    runLoop(100);
+    TEST_ASSERT_EQUAL(1, getPublishedCount("ESP1234567/rejected"));
+    runLoop(60000);
+}
+
+void test_full_pool_takes_command_replacing_pending_one() {
+    ulong rejectedCount = mqttRejectedCount;
+    ulong coalescedCount = mqttCoalescedCount;
+
+    receive("ESP1234567/shutter1/set_position", "40");
+    for (uint i = 1; i < MQTT_POOL_SIZE; i++) {
+        receive("ESP1234567/group/set", i % 2 == 0 ? "up" : "down");
+    }
+    TEST_ASSERT_TRUE(mqttPoolFreeSlots.isEmpty());
+
+    // the newer command for shutter 1 does not need a slot of its own, it takes the one of the pending command
+    receive("ESP1234567/shutter1/set_position", "60");
+
+    TEST_ASSERT_EQUAL(rejectedCount, mqttRejectedCount);
+    TEST_ASSERT_EQUAL(coalescedCount + 1, mqttCoalescedCount);
+    TEST_ASSERT_EQUAL(1, mqttQueueShutter[0].size());
+    TEST_ASSERT_EQUAL(60, mqttPool[mqttQueueShutter[0].first()].position);
+    runLoop(60000);
+}
+
+uint getPressCount(uint8_t pin) {
+    uint count = 0;
+
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.pin == pin && pinWrite.value == HIGH) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_group_command_replaces_planned_group_move() {
+    ulong busyCount = diagnostics.busyCount;
+
+    receive("ESP1234567/shutter1/set_position", "50");
+    runLoop(200);
+    while (shutters[0].isMoving() || shutters[0].isButtonPressed()) {
+        runLoop(1);
+    }
+    nativeHost.clearPinWrites();
+
+    // the first group move waits for the hold-off of shutter 1, the second one replaces it before it started
+    receive("ESP1234567/group/set", "down");
+    runLoop(10);
+    receive("ESP1234567/group/set", "up");
+    runLoop(40000);
+
+    TEST_ASSERT_EQUAL(busyCount, diagnostics.busyCount);
+    TEST_ASSERT_EQUAL(0, getPressCount(SHUTTER_CONFIG[0].pinDown) + getPressCount(SHUTTER_CONFIG[1].pinDown));
+    TEST_ASSERT_EQUAL(100, shutters[0].getPosition());
+    TEST_ASSERT_EQUAL(100, shutters[1].getPosition());
+}
+
+void test_batch_entry_waits_for_pressed_button() {
+    ulong busyCount = diagnostics.busyCount;
+
+    receive("ESP1234567/shutter1/set", "down");
+    runLoop(20);
+    TEST_ASSERT_TRUE(shutters[0].isButtonPressed());
+
+    // the move started by the button continues to the position of the batch
+    receive("ESP1234567/batch/set", "1:50");
+    runLoop(20000);
+
+    TEST_ASSERT_EQUAL(busyCount, diagnostics.busyCount);
+    TEST_ASSERT_EQUAL(50, shutters[0].getPosition());
+}
+
+void test_group_move_does_not_repeat_executed_batch() {
+    receive("ESP1234567/batch/set", "1:30,2:70");
+    runLoop(40000);
+    TEST_ASSERT_EQUAL(70, shutters[1].getPosition());
+
+    // the group entry of shutter 1 waits for its button, the batch executed before must not come back with it
+    receive("ESP1234567/shutter1/set", "down");
+    runLoop(20);
+    TEST_ASSERT_TRUE(shutters[0].isButtonPressed());
+    receive("ESP1234567/group/set", "up");
+    runLoop(40000);
+
+    TEST_ASSERT_EQUAL(100, shutters[0].getPosition());
+    TEST_ASSERT_EQUAL(100, shutters[1].getPosition());
+}
+
+void test_batches_for_different_shutters_keep_their_entries() {
+    receive("ESP1234567/batch/set", "1:30,2:70");
+    runLoop(40000);
+
+    // the group entry of shutter 2 waits for its button, the batch for shutter 2 joins it, shutter 1 keeps the group move
+    receive("ESP1234567/shutter2/set", "down");
+    runLoop(20);
+    TEST_ASSERT_TRUE(shutters[1].isButtonPressed());
+    receive("ESP1234567/group/set", "up");
+    runLoop(1);
+    TEST_ASSERT_TRUE(mqttBatch.pending);
+    receive("ESP1234567/batch/set", "2:60");
+    runLoop(40000);
+
+    TEST_ASSERT_EQUAL(100, shutters[0].getPosition());
+    TEST_ASSERT_EQUAL(60, shutters[1].getPosition());
+
+    // two batches pending at the same time are merged, each of them keeps the entry of its own shutter
+    receive("ESP1234567/shutter1/set", "down");
+    runLoop(20);
+    receive("ESP1234567/batch/set", "1:40");
+    receive("ESP1234567/batch/set", "2:60");
+    runLoop(40000);
+
+    TEST_ASSERT_EQUAL(40, shutters[0].getPosition());
+    TEST_ASSERT_EQUAL(60, shutters[1].getPosition());
+}
+
+void test_batch_stop_is_applied_right_away() {
+    receive("ESP1234567/shutter1/set", "down");
+    receive("ESP1234567/shutter2/set", "down");
+    runLoop(2000);
+    receive("ESP1234567/shutter2/set", "stop");
+    runLoop(200);
+    TEST_ASSERT_TRUE(shutters[0].isMoving());
+    nativeHost.clearPinWrites();
+
+    // shutter 1 is stopped in the same loop iteration, it does not wait for the hold-off of shutter 2
+    receive("ESP1234567/batch/set", "1:stop,2:60");
+    runLoop(1);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(SHUTTER_CONFIG[0].pinStop));
+    runLoop(20000);
+    TEST_ASSERT_FALSE(shutters[0].isActionInProgress());
+    TEST_ASSERT_EQUAL(60, shutters[1].getPosition());
+}
+
+void test_calibration_is_saved_from_the_loop() {
+    nativeHost.files.erase(CONFIG_FILE);
+
+    // the callback only applies the calibration, the flash is written by the loop afterwards
+    receive("ESP1234567/shutter2/calibrate", "14000,13000,120,50,30");
+    TEST_ASSERT_FALSE(LittleFS.exists(CONFIG_FILE));
+    TEST_ASSERT_EQUAL(14000, shutterCalibration[1].durationUpMs);
+
+    runLoop(10);
+    TEST_ASSERT_TRUE(LittleFS.exists(CONFIG_FILE));
+}
+
+void test_rejected_command_keeps_journaled_move() {
+    PositionJournal restarted;
+    uint position;
+
+    receive("ESP1234567/shutter1/set_position", "80");
+    runLoop(20000);
+    receive("ESP1234567/shutter1/set", "down");
+    runLoop(20);
+
+    // the move is journaled after the press, a command rejected meanwhile does not overwrite it
+    TEST_ASSERT_FALSE(shutters[0].executeAction(ShutterAction::UP));
+    runLoop(20);
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(0, position);
+    runLoop(20000);
+}
+
+void test_json_state_follows_published_position() {
+    receive("ESP1234567/shutter2/set", "down");
+    runLoop(20000);
+    nativeHost.clearPublished();
+
+    // the first estimates of the move are too close to 0 to be published as position
+    receive("ESP1234567/shutter2/set", "up");
+    runLoop(20000);
+
+    TEST_ASSERT_GREATER_THAN(2, getPublishedCount("ESP1234567/shutter2/json"));
+    for (const NativeMqttMessage &message : nativeHost.getPublished()) {
+        if (message.topic == "ESP1234567/shutter2/json") {
+            TEST_ASSERT_TRUE(message.payload.find("\"position\":-") == std::string::npos);
+            TEST_ASSERT_TRUE(message.payload.find("\"position\":4294967295") == std::string::npos);
+        }
+    }
+}
+
+void test_unchanged_state_is_not_published() {
+    receive("ESP1234567/shutter1/set_position", "30");
+    runLoop(20000);
+    nativeHost.clearPublished();
+
+    // the shutter is already at the position, nothing changed
+    receive("ESP1234567/shutter1/set_position", "30");
+    runLoop(1000);
+
+    TEST_ASSERT_EQUAL(0, getPublishedCount("ESP1234567/shutter1/state"));
+    TEST_ASSERT_EQUAL(0, getPublishedCount("ESP1234567/shutter1/position"));
+}
+
+void test_diagnostics_report_every_stage() {
+    std::string payload;
+
+    runLoop(DIAGNOSTICS_PUBLISH_INTERVAL_MS);
+
+    for (const NativeMqttMessage &message : nativeHost.getPublished()) {
+        if (message.topic == "ESP1234567/diagnostics") {
+            payload = message.payload;
+        }
+    }
+
+    // the stages of the loop are reported apart, so the one holding it up shows, and the longest tick of every shutter
+    TEST_ASSERT_FALSE(payload.empty());
+    for (const char *stage : {"\"mdns\"", "\"mqtt\"", "\"shutters\"", "\"queue\"", "\"publish\"", "\"log\"", "\"flash\""}) {
+        TEST_ASSERT_TRUE(payload.find(stage) != std::string::npos);
+    }
+    TEST_ASSERT_TRUE(payload.find("\"tick_max\":[") != std::string::npos);
+}
+
+int main(int argc, char **argv) {
+    setup();
+    runLoop(1000);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_topics_are_resolved);
+    RUN_TEST(test_topics_are_built);
+    RUN_TEST(test_payloads_are_parsed);
+    RUN_TEST(test_batch_is_parsed_as_a_whole);
+    RUN_TEST(test_newer_command_supersedes_pending_one);
+    RUN_TEST(test_stop_is_applied_right_away);
+    RUN_TEST(test_full_pool_rejects_newest_message);
+    RUN_TEST(test_full_pool_takes_command_replacing_pending_one);
+    RUN_TEST(test_group_command_replaces_planned_group_move);
+    RUN_TEST(test_batch_entry_waits_for_pressed_button);
+    RUN_TEST(test_group_move_does_not_repeat_executed_batch);
+    RUN_TEST(test_batches_for_different_shutters_keep_their_entries);
+    RUN_TEST(test_batch_stop_is_applied_right_away);
+    RUN_TEST(test_calibration_is_saved_from_the_loop);
+    RUN_TEST(test_rejected_command_keeps_journaled_move);
+    RUN_TEST(test_json_state_follows_published_position);
+    RUN_TEST(test_unchanged_state_is_not_published);
+    RUN_TEST(test_diagnostics_report_every_stage);
+    return UNITY_END();
+}
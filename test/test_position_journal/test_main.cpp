@@ -0,0 +1,192 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "PositionJournal.hpp"
+
+void setUp() {
+    nativeHost.reset();
+}
+
+void tearDown() {
+}
+
+size_t getJournalSize() {
+    return nativeHost.files[POSITION_JOURNAL_FILE].size();
+}
+
+void test_empty_journal_restores_nothing() {
+    PositionJournal journal;
+    uint position;
+
+    journal.begin();
+
+    TEST_ASSERT_FALSE(journal.getPosition(0, position));
+}
+
+void test_positions_survive_a_restart() {
+    PositionJournal journal;
+    PositionJournal restarted;
+    uint position;
+
+    journal.begin();
+    journal.recordPosition(0, 40);
+    journal.recordPosition(1, 70);
+    journal.recordPosition(0, 30);
+    journal.flush();
+
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(30, position);
+    TEST_ASSERT_TRUE(restarted.getPosition(1, position));
+    TEST_ASSERT_EQUAL(70, position);
+}
+
+void test_unchanged_position_is_not_written() {
+    PositionJournal journal;
+    size_t journalSize;
+
+    journal.begin();
+    journal.recordPosition(0, 40);
+    journal.flush();
+    journalSize = getJournalSize();
+    journal.recordPosition(0, 40);
+    journal.flush();
+
+    TEST_ASSERT_EQUAL(journalSize, getJournalSize());
+}
+
+void test_flush_writes_latest_change_only() {
+    PositionJournal journal;
+    PositionJournal restarted;
+    uint position;
+
+    journal.begin();
+    journal.recordMove(0, 40, ShutterAction::DOWN);
+    journal.recordPosition(0, 20);
+    TEST_ASSERT_TRUE(journal.isFlushPending());
+    TEST_ASSERT_EQUAL(0, getJournalSize());
+
+    // the move completed before the journal was written, only its end is recorded
+    journal.flush();
+    TEST_ASSERT_FALSE(journal.isFlushPending());
+    TEST_ASSERT_EQUAL(5, getJournalSize());
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(20, position);
+}
+
+void test_interrupted_move_restores_end_position() {
+    PositionJournal journal;
+    PositionJournal restarted;
+    uint position;
+
+    // power loss after the move started, the motor ran into the end position
+    journal.begin();
+    journal.recordPosition(0, 40);
+    journal.recordMove(0, 40, ShutterAction::DOWN);
+    journal.recordMove(1, 40, ShutterAction::UP);
+    journal.flush();
+
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(0, position);
+    TEST_ASSERT_TRUE(restarted.getPosition(1, position));
+    TEST_ASSERT_EQUAL(100, position);
+}
+
+void test_torn_record_ends_journal_and_is_compacted() {
+    PositionJournal journal;
+    PositionJournal restarted;
+    uint position;
+
+    journal.begin();
+    journal.recordPosition(0, 40);
+    journal.flush();
+    journal.recordPosition(0, 60);
+    journal.flush();
+
+    // a power loss during the append leaves half a record behind
+    nativeHost.files[POSITION_JOURNAL_FILE].append("\xA5\x00", 2);
+
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(60, position);
+    TEST_ASSERT_EQUAL(5, getJournalSize());
+    TEST_ASSERT_EQUAL(0, nativeHost.files.count(POSITION_JOURNAL_COMPACT_FILE));
+}
+
+void test_full_journal_is_compacted() {
+    PositionJournal journal;
+    PositionJournal restarted;
+    uint position;
+
+    journal.begin();
+    for (uint i = 0; i <= POSITION_JOURNAL_MAX_RECORDS; i++) {
+        journal.recordPosition(i % 2, i % 101);
+        journal.flush();
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL(POSITION_JOURNAL_MAX_RECORDS * 5, getJournalSize());
+    restarted.begin();
+    TEST_ASSERT_TRUE(restarted.getPosition(0, position));
+    TEST_ASSERT_EQUAL(POSITION_JOURNAL_MAX_RECORDS % 101, position);
+    TEST_ASSERT_TRUE(restarted.getPosition(1, position));
+    TEST_ASSERT_EQUAL((POSITION_JOURNAL_MAX_RECORDS - 1) % 101, position);
+}
+
+/* moves of the flash wear test, each of them records its start and its end */
+#define JOURNAL_MOVES 10000
+
+void test_flash_writes_of_10000_moves() {
+    PositionJournal journal;
+    uint positions[SHUTTER_COUNT] = {};
+    uint target;
+    uint compactions = 0;
+    size_t journalSize = 0;
+    ulong changes = 2 * JOURNAL_MOVES;
+    ulong expectedCompactions;
+
+    journal.begin();
+    for (uint i = 0; i < JOURNAL_MOVES; i++) {
+        uint shutterIndex = i % SHUTTER_COUNT;
+
+        target = (i * 37) % 101;
+        journal.recordMove(shutterIndex, positions[shutterIndex], target < positions[shutterIndex] ? ShutterAction::DOWN : ShutterAction::UP);
+        journal.flush();
+        journal.recordPosition(shutterIndex, target);
+        journal.flush();
+        positions[shutterIndex] = target;
+
+        // the journal only shrinks when it is compacted
+        if (getJournalSize() < journalSize) {
+            compactions++;
+        }
+        journalSize = getJournalSize();
+    }
+    printf("JOURNAL %d moves, %lu bytes written, %lu sector erases, %u compactions\n", JOURNAL_MOVES, nativeHost.fileBytesWritten,
+        nativeHost.flashSectorErases, compactions);
+
+    // the first compaction follows the full journal, every further one a journal filled up again from the records of
+    // all shutters, the change that triggers a compaction is part of the compacted journal instead of being appended
+    expectedCompactions = 1 + (changes - POSITION_JOURNAL_MAX_RECORDS - 1) / (POSITION_JOURNAL_MAX_RECORDS - SHUTTER_COUNT + 1);
+    TEST_ASSERT_EQUAL(expectedCompactions, compactions);
+    TEST_ASSERT_EQUAL((changes - compactions) * 5 + compactions * SHUTTER_COUNT * 5, nativeHost.fileBytesWritten);
+
+    // every append and every compacted journal is written by a handle of its own into a single sector, so each
+    // change costs one sector erase, LittleFS spreads them over all free blocks of the file system
+    TEST_ASSERT_EQUAL(changes, nativeHost.flashSectorErases);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_journal_restores_nothing);
+    RUN_TEST(test_positions_survive_a_restart);
+    RUN_TEST(test_unchanged_position_is_not_written);
+    RUN_TEST(test_flush_writes_latest_change_only);
+    RUN_TEST(test_interrupted_move_restores_end_position);
+    RUN_TEST(test_torn_record_ends_journal_and_is_compacted);
+    RUN_TEST(test_full_journal_is_compacted);
+    RUN_TEST(test_flash_writes_of_10000_moves);
+    return UNITY_END();
+}
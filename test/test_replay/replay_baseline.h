@@ -0,0 +1,40 @@
+#pragma once
+
+// TRACE lines of the replay, times are relative to the replay start, regenerate from the output of a failing run when
+// a change of the timing is intended
+const char *REPLAY_BASELINE = R"(
+TRACE rx 0 ESPs/cmd announce
+TRACE rx 6870907 ESP1234567/group/set up
+TRACE done 6871008 1 wait 0 start 1 complete 101 position 100 reason 0
+TRACE done 6871127 2 wait 0 start 120 complete 220 position 100 reason 0
+TRACE rx 6871682 ESP1234567/shutter2/set_position 60
+TRACE done 6878828 2 wait 945 start 946 complete 7146 position 60 reason 0
+TRACE rx 6879300 ESP1234567/shutter1/set_position 70
+TRACE rx 6879816 ESP1234567/shutter1/set_position 50
+TRACE done 6879816 1 wait 0 start 1 complete 516 position 98 reason 2
+TRACE rx 6880273 ESP1234567/shutter1/set_position 40
+TRACE done 6880273 1 wait 0 start -1 complete 457 position 95 reason 2
+TRACE done 6888891 1 wait 0 start 8518 complete 8618 position 40 reason 0
+TRACE rx 9413025 ESP1234567/batch/set 1:20, 2:30
+TRACE rx 9414895 ESP1234567/shutter2/set stop
+TRACE done 9414895 2 wait 0 start 120 complete 1870 position 49 reason 2
+TRACE done 9414995 2 wait 0 start 0 complete 100 position 49 reason 0
+TRACE done 9416356 1 wait 0 start 1 complete 3331 position 20 reason 0
+TRACE rx 9417843 ESP1234567/group/set_position 0
+TRACE rx 9418907 ESP1234567/group/set_position 100
+TRACE done 9418907 1 wait 0 start 13 complete 1064 position 14 reason 2
+TRACE done 9418907 2 wait 0 start 133 complete 1064 position 44 reason 2
+TRACE done 9429277 2 wait 0 start 120 complete 10370 position 100 reason 0
+TRACE done 9434067 1 wait 0 start 1 complete 15160 position 100 reason 0
+TRACE rx 11968801 ESP1234567/shutter1/set down
+TRACE rx 11969312 ESP1234567/batch/set 1:stop,2:down
+TRACE done 11969312 1 wait 0 start 1 complete 511 position 98 reason 2
+TRACE done 11969412 1 wait 0 start 0 complete 100 position 98 reason 0
+TRACE rx 11978665 ESPs/cmd stop
+TRACE done 11978665 2 wait 0 start 1 complete 9353 position 39 reason 2
+TRACE done 11978765 1 wait 0 start 0 complete 100 position 98 reason 0
+TRACE done 11978885 2 wait 0 start 120 complete 220 position 38 reason 0
+TRACE rx 11981192 ESP1234567/group/set up
+TRACE done 11981606 1 wait 0 start 1 complete 414 position 100 reason 0
+TRACE done 11990712 2 wait 0 start 120 complete 9520 position 100 reason 0
+)";
@@ -0,0 +1,22 @@
+#pragma once
+
+// serial log of the native environment with MQTT_TRACE, captured from test_replay, the messages are a synthetic evening
+// of a household with two shutters, not a recording of a device: group moves, a shutter retargeted twice while it
+// waits, batches and STOPs in between. Only the "TRACE rx" lines are replayed, the client ID is replaced by the one of
+// the replaying device
+const char *REPLAY_TRACE = R"(
+      2000 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 2000 ESPs/cmd announce
+   6872907 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 6872907 ESP1234567/group/set up
+   6873682 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 6873682 ESP1234567/shutter2/set_position 60
+   6881300 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 6881300 ESP1234567/shutter1/set_position 70
+   6881816 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 6881816 ESP1234567/shutter1/set_position 50
+   6882273 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 6882273 ESP1234567/shutter1/set_position 40
+   9415025 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 9415025 ESP1234567/batch/set 1:20, 2:30
+   9416895 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 9416895 ESP1234567/shutter2/set stop
+   9419843 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 9419843 ESP1234567/group/set_position 0
+   9420907 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 9420907 ESP1234567/group/set_position 100
+  11970801 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 11970801 ESP1234567/shutter1/set down
+  11971312 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 11971312 ESP1234567/batch/set 1:stop,2:down
+  11980665 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 11980665 ESPs/cmd stop
+  11983192 N: [ test/test_replay/../../src/main.cpp:462 ] TRACE rx 11983192 ESP1234567/group/set up
+)";
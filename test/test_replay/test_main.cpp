@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <sstream>
+
+// every received message and completed command is traced, the replay compares those lines
+#define MQTT_TRACE true
+#include "../../src/main.cpp"
+
+#include "replay_trace.h"
+#include "replay_baseline.h"
+
+/* time in ms the replay keeps running after the last message, so all commands are completed */
+#define REPLAY_SETTLE_MS 60000
+
+ulong replayStartMillis;
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+// the client ID of the trace is replaced, global topics like ESPs/cmd are kept
+std::string getReplayTopic(const std::string &topic) {
+    size_t prefixEnd = topic.find('/');
+
+    if (topic == MQTT_GLOBAL_CMD_TOPIC || prefixEnd == std::string::npos) {
+        return topic;
+    }
+    return clientId.c_str() + topic.substr(prefixEnd);
+}
+
+// schedules the received messages of the trace relative to the replay start, returns the time of the last one
+ulong scheduleTrace(const char *trace) {
+    std::istringstream lines(trace);
+    std::string line;
+    ulong firstMillis = 0;
+    ulong lastMillis = 0;
+    bool first = true;
+
+    while (std::getline(lines, line)) {
+        size_t traceBegin = line.find("TRACE rx ");
+        std::istringstream fields;
+        std::string topic;
+        std::string payload;
+        ulong receivedMillis;
+
+        if (traceBegin == std::string::npos) {
+            continue;
+        }
+
+        fields.str(line.substr(traceBegin + 9));
+        fields >> receivedMillis >> topic;
+        std::getline(fields >> std::ws, payload);
+
+        if (first) {
+            firstMillis = receivedMillis;
+            first = false;
+        }
+        lastMillis = receivedMillis - firstMillis;
+        nativeHost.receiveMqtt(replayStartMillis + lastMillis, getReplayTopic(topic), payload);
+    }
+
+    return lastMillis;
+}
+
+// TRACE lines of the serial log with the millis shifted to the replay start, file and line of the log are left out
+std::string getTraceOutput(const std::string &serial) {
+    std::istringstream lines(serial);
+    std::ostringstream output;
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        size_t traceBegin = line.find("TRACE ");
+        std::istringstream fields;
+        std::string kind;
+        std::string rest;
+        ulong traceMillis;
+
+        if (traceBegin == std::string::npos) {
+            continue;
+        }
+
+        fields.str(line.substr(traceBegin + 6));
+        fields >> kind >> traceMillis;
+        std::getline(fields, rest);
+        output << "TRACE " << kind << " " << (traceMillis - replayStartMillis) << rest << "\n";
+    }
+
+    return output.str();
+}
+
+// runs the loop like on the device, an iteration with nothing to idle for takes a millisecond
+void runLoop(ulong ms) {
+    ulong endMillis = millis() + ms;
+    ulong iterationMillis;
+
+    while ((long) (millis() - endMillis) < 0) {
+        iterationMillis = millis();
+        loop();
+        if (millis() == iterationMillis) {
+            nativeHost.advanceMillis(1);
+        }
+    }
+}
+
+void test_replay_matches_baseline() {
+    std::string serial;
+    std::string output;
+    std::string baseline = REPLAY_BASELINE + 1;
+    ulong lastMillis;
+
+    lastMillis = scheduleTrace(REPLAY_TRACE);
+    runLoop(lastMillis + REPLAY_SETTLE_MS);
+    while (!logBuffer.isEmpty()) {
+        runLoop(1);
+    }
+
+    output = getTraceOutput(nativeHost.takeSerial());
+    if (output != baseline) {
+        // the new output is printed in full, so it can be taken over as baseline once the change is intended
+        printf("Replay differs from replay_baseline.h, output of this build:\n%s", output.c_str());
+    }
+
+    TEST_ASSERT_EQUAL(0, logBuffer.getDroppedCount());
+    TEST_ASSERT_EQUAL_STRING(baseline.c_str(), output.c_str());
+}
+
+void test_dropped_records_are_traced() {
+    std::string serial;
+    ulong droppedCount = logBuffer.getDroppedCount();
+
+    // a burst without a chance to drain overflows the ring, the next drain reports it next to the trace
+    for (int i = 0; i < LOG_BUFFER_SIZE; i++) {
+        LOG_NOTICE("TRACE rx %l burst/%d", millis(), i);
+    }
+    TEST_ASSERT_TRUE(logBuffer.getDroppedCount() > droppedCount);
+
+    runLoop(1000);
+    while (!logBuffer.isEmpty()) {
+        runLoop(1);
+    }
+
+    serial = nativeHost.takeSerial();
+    TEST_ASSERT_TRUE(serial.find("TRACE dropped ") != std::string::npos);
+}
+
+int main(int argc, char **argv) {
+    setup();
+    runLoop(1000);
+    nativeHost.takeSerial();
+    replayStartMillis = millis();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_matches_baseline);
+    RUN_TEST(test_dropped_records_are_traced);
+    return UNITY_END();
+}
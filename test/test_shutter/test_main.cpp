@@ -0,0 +1,328 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Shutter.hpp"
+
+#define PIN_UP 1
+#define PIN_DOWN 2
+#define PIN_STOP 3
+
+uint completeCount;
+ShutterReason lastReason;
+
+void setUp() {
+    nativeHost.reset();
+    completeCount = 0;
+    lastReason = ShutterReason::SUCCESS;
+}
+
+void tearDown() {
+}
+
+// shutter of 10s for a full move in both directions, released buttons are held 100ms
+void setupShutter(Shutter &shutter, uint startLatencyMs = 0, uint stopLatencyMs = 0) {
+    shutter.setControlPins(PIN_UP, PIN_DOWN, PIN_STOP);
+    shutter.setDurationFullMoveMs(10000);
+    shutter.setPressTimeMs(100);
+    shutter.setDelayTimeMs(1000);
+    shutter.setMotorLatencyMs(startLatencyMs, stopLatencyMs);
+    shutter.onActionComplete([](const String &id, ShutterAction shutterAction, ShutterReason reason) {
+        completeCount++;
+        lastReason = reason;
+    });
+    nativeHost.advanceMillis(1000);
+    nativeHost.clearPinWrites();
+}
+
+// ticks the shutter every millisecond like the loop does while it is idle
+void run(Shutter &shutter, ulong ms) {
+    for (ulong i = 0; i < ms; i++) {
+        shutter.tick();
+        nativeHost.advanceMillis(1);
+    }
+}
+
+// millis of the n-th press of the pin, 0 if it was not pressed that often
+ulong getPressMillis(uint8_t pin, uint n = 1) {
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.pin == pin && pinWrite.value == HIGH && --n == 0) {
+            return pinWrite.millis;
+        }
+    }
+    return 0;
+}
+
+uint getPressCount(uint8_t pin) {
+    uint count = 0;
+
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.pin == pin && pinWrite.value == HIGH) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_full_move_presses_button_without_stop() {
+    Shutter shutter("T");
+    ulong startMillis;
+
+    setupShutter(shutter);
+    startMillis = millis();
+    TEST_ASSERT_TRUE(shutter.executeAction(ShutterAction::DOWN));
+    run(shutter, 12000);
+
+    TEST_ASSERT_EQUAL(startMillis, getPressMillis(PIN_DOWN));
+    TEST_ASSERT_EQUAL(0, getPressCount(PIN_STOP));
+    TEST_ASSERT_EQUAL(0, shutter.getPosition());
+    TEST_ASSERT_EQUAL(1, completeCount);
+    TEST_ASSERT_FALSE(shutter.isMoving());
+}
+
+void test_position_compensates_motor_latency() {
+    Shutter shutter("T");
+    ulong startMillis;
+
+    // the motor starts 300ms after the press and runs 200ms after STOP, 50% take 5000ms
+    setupShutter(shutter, 300, 200);
+    startMillis = millis();
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 50);
+    run(shutter, 7000);
+
+    TEST_ASSERT_EQUAL(startMillis, getPressMillis(PIN_DOWN));
+    TEST_ASSERT_EQUAL(startMillis + 300 + 5000 - 200, getPressMillis(PIN_STOP));
+    TEST_ASSERT_EQUAL(50, shutter.getPosition());
+    TEST_ASSERT_EQUAL(1, completeCount);
+}
+
+void test_retarget_in_same_direction_moves_stop() {
+    Shutter shutter("T");
+    ulong startMillis;
+
+    setupShutter(shutter);
+    startMillis = millis();
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 50);
+    run(shutter, 2000);
+    TEST_ASSERT_TRUE(shutter.isMoving());
+    TEST_ASSERT_EQUAL(80, shutter.getEstimatedPosition());
+
+    // the running move continues, only its STOP is pressed later
+    TEST_ASSERT_TRUE(shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 30));
+    run(shutter, 8000);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_DOWN));
+    TEST_ASSERT_EQUAL(startMillis + 7000, getPressMillis(PIN_STOP));
+    TEST_ASSERT_EQUAL(30, shutter.getPosition());
+}
+
+void test_retarget_against_direction_stops_and_reverses() {
+    Shutter shutter("T");
+
+    setupShutter(shutter);
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 50);
+    run(shutter, 2000);
+
+    // STOP right away, the move up starts once the remote is ready again
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 90);
+    run(shutter, 12000);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_DOWN));
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_UP));
+    TEST_ASSERT_EQUAL(getPressMillis(PIN_STOP) + 100 + 1000, getPressMillis(PIN_UP));
+    TEST_ASSERT_EQUAL(90, shutter.getPosition());
+}
+
+void test_stop_while_moving_accounts_for_stop_latency() {
+    Shutter shutter("T");
+
+    setupShutter(shutter, 0, 500);
+    shutter.executeAction(ShutterAction::DOWN);
+    run(shutter, 3000);
+
+    // the motor keeps running for another 500ms, so the shutter ends up 35% lower
+    shutter.executeAction(ShutterAction::STOP);
+    run(shutter, 2000);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_STOP));
+    TEST_ASSERT_EQUAL(65, shutter.getPosition());
+    TEST_ASSERT_EQUAL(1, completeCount);
+}
+
+void test_stop_while_button_held_stops_after_release() {
+    Shutter shutter("T");
+
+    setupShutter(shutter);
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 20);
+    run(shutter, 50);
+    shutter.executeAction(ShutterAction::STOP);
+    run(shutter, 2000);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_DOWN));
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_STOP));
+    TEST_ASSERT_GREATER_OR_EQUAL(99, shutter.getPosition());
+}
+
+void test_stop_drops_planned_task() {
+    Shutter shutter("T");
+
+    setupShutter(shutter);
+    shutter.executeActionAt(ShutterAction::UP, 100, millis() + 500);
+    shutter.executeAction(ShutterAction::STOP);
+    run(shutter, 1000);
+
+    TEST_ASSERT_EQUAL(0, nativeHost.getPinWrites().size());
+    TEST_ASSERT_FALSE(shutter.isActionInProgress());
+}
+
+void test_planned_task_is_replaced() {
+    Shutter shutter("T");
+
+    setupShutter(shutter);
+    shutter.executeAction(ShutterAction::DOWN);
+    run(shutter, 12000);
+
+    // no button was pressed for the planned move yet, so the newer one takes its place
+    TEST_ASSERT_TRUE(shutter.executeActionAt(ShutterAction::UP, 100, millis() + 500));
+    TEST_ASSERT_TRUE(shutter.executeActionAt(ShutterAction::MOVE_BY_POSITION, 30, millis() + 500));
+    run(shutter, 5000);
+
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_DOWN));
+    TEST_ASSERT_EQUAL(1, getPressCount(PIN_UP));
+    TEST_ASSERT_EQUAL(30, shutter.getPosition());
+    TEST_ASSERT_EQUAL(ShutterReason::SUCCESS, lastReason);
+}
+
+void test_action_within_hold_off_is_rejected() {
+    Shutter shutter("T");
+
+    setupShutter(shutter);
+    shutter.executeAction(ShutterAction::MOVE_BY_POSITION, 90);
+    run(shutter, 1200);
+    TEST_ASSERT_EQUAL(90, shutter.getPosition());
+
+    // the remote is not ready for the next press until the hold-off after the STOP is over
+    TEST_ASSERT_FALSE(shutter.executeAction(ShutterAction::DOWN));
+    TEST_ASSERT_EQUAL(ShutterReason::DEVICE_BUSY, lastReason);
+}
+
+/* motor of the position harness, the shutter is set up with the same timings */
+#define MOTOR_UP_MS 15650
+#define MOTOR_DOWN_MS 14320
+#define MOTOR_START_LATENCY_MS 250
+#define MOTOR_STOP_LATENCY_MS 150
+
+typedef struct {
+    uint position;
+    // 0 waits until the move is done, otherwise the next move follows after this time and adjusts the running one
+    ulong nextAfterMs;
+} harnessMove_t;
+
+const harnessMove_t HARNESS_MOVES[] = {
+    { 50, 0 }, { 20, 0 }, { 73, 0 }, { 74, 0 }, { 40, 0 },
+    { 10, 2000 }, { 25, 0 },
+    { 90, 4000 }, { 60, 0 },
+    { 5, 3000 }, { 70, 0 },
+    { 33, 0 }, { 34, 0 }, { 35, 0 }, { 0, 0 }, { 100, 0 },
+    { 66, 0 }, { 12, 0 }, { 99, 0 }, { 1, 0 },
+    { 45, 1500 }, { 80, 0 },
+    { 30, 0 }, { 31, 0 }, { 29, 0 }, { 57, 0 },
+};
+
+typedef struct {
+    ulong millis;
+    int direction;
+} motorEvent_t;
+
+// position of the motor driven by the pressed buttons, it follows a press after its latency and halts at the end positions
+double getMotorPosition() {
+    std::vector<motorEvent_t> events;
+    double position = 100;
+    int direction = 0;
+    ulong lastMillis = 0;
+
+    for (const NativePinWrite &pinWrite : nativeHost.getPinWrites()) {
+        if (pinWrite.value != HIGH) {
+            continue;
+        }
+        if (pinWrite.pin == PIN_STOP) {
+            events.push_back({pinWrite.millis + MOTOR_STOP_LATENCY_MS, 0});
+        } else {
+            events.push_back({pinWrite.millis + MOTOR_START_LATENCY_MS, pinWrite.pin == PIN_UP ? 1 : -1});
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const motorEvent_t &a, const motorEvent_t &b) {
+        return a.millis < b.millis;
+    });
+    events.push_back({millis(), 0});
+
+    for (const motorEvent_t &event : events) {
+        if (direction > 0) {
+            position = min(100.0, position + (event.millis - lastMillis) * 100.0 / MOTOR_UP_MS);
+        } else if (direction < 0) {
+            position = max(0.0, position - (event.millis - lastMillis) * 100.0 / MOTOR_DOWN_MS);
+        }
+        direction = event.direction;
+        lastMillis = event.millis;
+    }
+
+    return position;
+}
+
+void test_moves_keep_position_error_within_one_percent() {
+    Shutter shutter("T");
+    double error;
+    double maxError = 0;
+    double sumError = 0;
+    uint settledMoves = 0;
+
+    shutter.setControlPins(PIN_UP, PIN_DOWN, PIN_STOP);
+    shutter.setDurationFullMoveMs(MOTOR_UP_MS, MOTOR_DOWN_MS);
+    shutter.setMotorLatencyMs(MOTOR_START_LATENCY_MS, MOTOR_STOP_LATENCY_MS);
+    shutter.setPressTimeMs(100);
+    shutter.setDelayTimeMs(1000);
+    nativeHost.advanceMillis(1000);
+    nativeHost.clearPinWrites();
+
+    // the position the shutter believes in is compared with the motor once a move is done, errors must not add up
+    for (const harnessMove_t &move : HARNESS_MOVES) {
+        TEST_ASSERT_TRUE(shutter.executeAction(ShutterAction::MOVE_BY_POSITION, move.position));
+        if (move.nextAfterMs > 0) {
+            run(shutter, move.nextAfterMs);
+            continue;
+        }
+        while (shutter.isActionInProgress()) {
+            run(shutter, 1);
+        }
+        run(shutter, 1200);
+
+        error = shutter.getPosition() - getMotorPosition();
+        maxError = max(maxError, fabs(error));
+        sumError += error;
+        settledMoves++;
+        printf("HARNESS target %3u position %3u motor %6.2f error %+5.2f accumulated %+6.2f\n",
+            move.position, shutter.getPosition(), getMotorPosition(), error, sumError);
+    }
+    printf("HARNESS %u moves, max error %.2f%%, final error %+.2f%%\n", settledMoves, maxError, error);
+
+    TEST_ASSERT_LESS_OR_EQUAL(100, (long) (maxError * 100));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_move_presses_button_without_stop);
+    RUN_TEST(test_position_compensates_motor_latency);
+    RUN_TEST(test_retarget_in_same_direction_moves_stop);
+    RUN_TEST(test_retarget_against_direction_stops_and_reverses);
+    RUN_TEST(test_stop_while_moving_accounts_for_stop_latency);
+    RUN_TEST(test_stop_while_button_held_stops_after_release);
+    RUN_TEST(test_stop_drops_planned_task);
+    RUN_TEST(test_planned_task_is_replaced);
+    RUN_TEST(test_action_within_hold_off_is_rejected);
+    RUN_TEST(test_moves_keep_position_error_within_one_percent);
+    return UNITY_END();
+}